@@ -0,0 +1,110 @@
+#include "allocation_tracker.h"
+
+#ifdef PINGPONG_TRACK_ALLOCATIONS
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+static thread_local unsigned long long threadAllocations = 0;
+static std::atomic<unsigned long long> totalAllocations(0);
+
+static void *allocate(std::size_t size)
+{
+	++threadAllocations;
+	totalAllocations.fetch_add(1, std::memory_order_relaxed);
+	return std::malloc(size ? size : 1);
+}
+
+// replacements for the global allocation functions; not every standard
+// library forwards the nothrow and sized forms to the plain ones, so all
+// of them are replaced
+void *operator new(std::size_t size)
+{
+	void *memory = allocate(size);
+	if (!memory)
+		throw std::bad_alloc();
+	return memory;
+}
+
+void *operator new[](std::size_t size)
+{
+	void *memory = allocate(size);
+	if (!memory)
+		throw std::bad_alloc();
+	return memory;
+}
+
+void *operator new(std::size_t size, const std::nothrow_t&) noexcept
+{
+	return allocate(size);
+}
+
+void *operator new[](std::size_t size, const std::nothrow_t&) noexcept
+{
+	return allocate(size);
+}
+
+void operator delete(void *memory) noexcept
+{
+	std::free(memory);
+}
+
+void operator delete[](void *memory) noexcept
+{
+	std::free(memory);
+}
+
+void operator delete(void *memory, std::size_t) noexcept
+{
+	std::free(memory);
+}
+
+void operator delete[](void *memory, std::size_t) noexcept
+{
+	std::free(memory);
+}
+
+void operator delete(void *memory, const std::nothrow_t&) noexcept
+{
+	std::free(memory);
+}
+
+void operator delete[](void *memory, const std::nothrow_t&) noexcept
+{
+	std::free(memory);
+}
+
+bool AllocationTracker::Enabled()
+{
+	return true;
+}
+
+unsigned long long AllocationTracker::ThreadAllocations()
+{
+	return threadAllocations;
+}
+
+unsigned long long AllocationTracker::TotalAllocations()
+{
+	return totalAllocations.load(std::memory_order_relaxed);
+}
+
+#else
+
+bool AllocationTracker::Enabled()
+{
+	return false;
+}
+
+unsigned long long AllocationTracker::ThreadAllocations()
+{
+	return 0;
+}
+
+unsigned long long AllocationTracker::TotalAllocations()
+{
+	return 0;
+}
+
+#endif
@@ -0,0 +1,22 @@
+#ifndef ALLOCATION_TRACKER_H
+#define ALLOCATION_TRACKER_H
+
+
+// AllocationTracker counts heap allocations by replacing the global
+// operator new/delete when built with PINGPONG_TRACK_ALLOCATIONS; without
+// it the counters stay at zero and nothing is replaced. Take the counter
+// before and after a frame to get that frame's allocations.
+class AllocationTracker
+{
+public:
+	// true if operator new is instrumented in this build
+	static bool Enabled();
+	// allocations made by the calling thread so far
+	static unsigned long long ThreadAllocations();
+	// allocations made by all threads so far
+	static unsigned long long TotalAllocations();
+private:
+	AllocationTracker() { }
+};
+
+#endif
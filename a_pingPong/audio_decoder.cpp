@@ -0,0 +1,251 @@
+#include "audio_decoder.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <string>
+
+#ifdef PINGPONG_HAVE_MPG123
+#include <mpg123.h>
+#endif
+#ifdef PINGPONG_HAVE_VORBIS
+#include <vorbis/vorbisfile.h>
+#endif
+
+
+// Uncompressed RIFF/WAVE files with 8 or 16-bit PCM samples
+class WavStream : public AudioStream
+{
+public:
+	WavStream() : file(nullptr), bits(16), dataStart(0), dataFrames(0), position(0) { }
+	~WavStream() { if (this->file) fclose(this->file); }
+	bool Open(const char *path)
+	{
+		this->file = fopen(path, "rb");
+		if (!this->file)
+			return false;
+		char riff[12];
+		if (fread(riff, 1, 12, this->file) != 12 || memcmp(riff, "RIFF", 4) != 0 || memcmp(riff + 8, "WAVE", 4) != 0)
+			return false;
+		// walk the chunks until we have seen both the format and the data
+		bool haveFormat = false;
+		char id[4];
+		unsigned int size;
+		while (fread(id, 1, 4, this->file) == 4 && fread(&size, 4, 1, this->file) == 1)
+		{
+			if (memcmp(id, "fmt ", 4) == 0)
+			{
+				unsigned char format[16];
+				if (size < 16 || fread(format, 1, 16, this->file) != 16)
+					return false;
+				unsigned short tag = format[0] | (format[1] << 8);
+				this->Channels = format[2] | (format[3] << 8);
+				this->SampleRate = format[4] | (format[5] << 8) | (format[6] << 16) | (format[7] << 24);
+				this->bits = format[14] | (format[15] << 8);
+				if (tag != 1 || (this->bits != 8 && this->bits != 16) || this->Channels == 0)
+					return false;
+				fseek(this->file, (size - 16 + 1) & ~1u, SEEK_CUR);
+				haveFormat = true;
+			}
+			else if (memcmp(id, "data", 4) == 0 && haveFormat)
+			{
+				this->dataStart = ftell(this->file);
+				this->dataFrames = size / (this->Channels * (this->bits / 8));
+				return true;
+			}
+			else
+				fseek(this->file, (size + 1) & ~1u, SEEK_CUR);
+		}
+		return false;
+	}
+	unsigned int Read(short *out, unsigned int frames) override
+	{
+		frames = std::min(frames, this->dataFrames - this->position);
+		if (this->bits == 16)
+			frames = static_cast<unsigned int>(fread(out, sizeof(short) * this->Channels, frames, this->file));
+		else
+		{
+			// widen 8-bit unsigned samples in place, back to front
+			unsigned char *bytes = reinterpret_cast<unsigned char*>(out);
+			frames = static_cast<unsigned int>(fread(bytes, this->Channels, frames, this->file));
+			for (unsigned int i = frames * this->Channels; i-- > 0; )
+				out[i] = static_cast<short>((bytes[i] - 128) << 8);
+		}
+		this->position += frames;
+		return frames;
+	}
+	bool Rewind() override
+	{
+		this->position = 0;
+		return fseek(this->file, this->dataStart, SEEK_SET) == 0;
+	}
+private:
+	FILE *file;
+	unsigned int bits;
+	long dataStart;
+	unsigned int dataFrames, position;
+};
+
+
+#ifdef PINGPONG_HAVE_MPG123
+// MPEG audio through libmpg123, forced to 16-bit output
+class Mp3Stream : public AudioStream
+{
+public:
+	Mp3Stream() : handle(nullptr) { }
+	~Mp3Stream()
+	{
+		if (this->handle)
+		{
+			mpg123_close(this->handle);
+			mpg123_delete(this->handle);
+		}
+	}
+	bool Open(const char *path)
+	{
+		static bool initialized = (mpg123_init() == MPG123_OK);
+		int error;
+		this->handle = initialized ? mpg123_new(nullptr, &error) : nullptr;
+		if (!this->handle || mpg123_open(this->handle, path) != MPG123_OK)
+			return false;
+		long rate;
+		int channels, encoding;
+		if (mpg123_getformat(this->handle, &rate, &channels, &encoding) != MPG123_OK)
+			return false;
+		// lock the output format so it cannot change mid-stream
+		mpg123_format_none(this->handle);
+		mpg123_format(this->handle, rate, channels, MPG123_ENC_SIGNED_16);
+		this->SampleRate = static_cast<unsigned int>(rate);
+		this->Channels = static_cast<unsigned int>(channels);
+		return true;
+	}
+	unsigned int Read(short *out, unsigned int frames) override
+	{
+		size_t done = 0;
+		int result = mpg123_read(this->handle, reinterpret_cast<unsigned char*>(out), frames * this->Channels * sizeof(short), &done);
+		if (result != MPG123_OK && result != MPG123_DONE && result != MPG123_NEW_FORMAT)
+			return 0;
+		return static_cast<unsigned int>(done / (this->Channels * sizeof(short)));
+	}
+	bool Rewind() override
+	{
+		return mpg123_seek(this->handle, 0, SEEK_SET) >= 0;
+	}
+private:
+	mpg123_handle *handle;
+};
+#endif
+
+
+#ifdef PINGPONG_HAVE_VORBIS
+// Ogg Vorbis through libvorbisfile
+class OggStream : public AudioStream
+{
+public:
+	OggStream() : open(false) { }
+	~OggStream() { if (this->open) ov_clear(&this->file); }
+	bool Open(const char *path)
+	{
+		if (ov_fopen(path, &this->file) != 0)
+			return false;
+		this->open = true;
+		vorbis_info *info = ov_info(&this->file, -1);
+		this->SampleRate = static_cast<unsigned int>(info->rate);
+		this->Channels = static_cast<unsigned int>(info->channels);
+		return true;
+	}
+	unsigned int Read(short *out, unsigned int frames) override
+	{
+		// ov_read returns at most one packet per call, so keep going until the request is filled
+		char *target = reinterpret_cast<char*>(out);
+		int remaining = static_cast<int>(frames * this->Channels * sizeof(short));
+		int bitstream;
+		while (remaining > 0)
+		{
+			long read = ov_read(&this->file, target, remaining, 0, 2, 1, &bitstream);
+			if (read <= 0)
+				break;
+			target += read;
+			remaining -= static_cast<int>(read);
+		}
+		return static_cast<unsigned int>((target - reinterpret_cast<char*>(out)) / (this->Channels * sizeof(short)));
+	}
+	bool Rewind() override
+	{
+		return ov_pcm_seek(&this->file, 0) == 0;
+	}
+private:
+	OggVorbis_File file;
+	bool open;
+};
+#endif
+
+
+// opens a concrete stream type, deleting it again if the file cannot be read
+template <typename T>
+static AudioStream *openStream(const char *file)
+{
+	T *stream = new T();
+	if (stream->Open(file))
+		return stream;
+	delete stream;
+	return nullptr;
+}
+
+AudioStream *OpenAudioStream(const char *file)
+{
+	std::string path(file);
+	std::string extension = path.substr(path.find_last_of('.') + 1);
+	std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+	AudioStream *stream = nullptr;
+	if (extension == "wav")
+		stream = openStream<WavStream>(file);
+#ifdef PINGPONG_HAVE_MPG123
+	else if (extension == "mp3")
+		stream = openStream<Mp3Stream>(file);
+#endif
+#ifdef PINGPONG_HAVE_VORBIS
+	else if (extension == "ogg")
+		stream = openStream<OggStream>(file);
+#endif
+	if (!stream)
+		std::cout << "ERROR::AUDIO: Unsupported or unreadable audio file: " << file << std::endl;
+	return stream;
+}
+
+bool DecodeSoundFile(const char *file, unsigned int sampleRate, unsigned int channels, SoundBuffer &buffer)
+{
+	AudioStream *stream = OpenAudioStream(file);
+	if (!stream)
+		return false;
+	// decode everything in the source format first
+	std::vector<short> source;
+	std::vector<short> block(4096 * stream->Channels);
+	unsigned int read;
+	while ((read = stream->Read(&block[0], 4096)) > 0)
+		source.insert(source.end(), block.begin(), block.begin() + read * stream->Channels);
+	unsigned int sourceChannels = stream->Channels;
+	unsigned int sourceFrames = static_cast<unsigned int>(source.size() / sourceChannels);
+	double step = static_cast<double>(stream->SampleRate) / sampleRate;
+	delete stream;
+	if (sourceFrames == 0)
+		return false;
+	// then convert rate and channel count (linear resampling is plenty for short effects)
+	buffer.Frames = static_cast<unsigned int>(sourceFrames / step);
+	buffer.Samples.resize(buffer.Frames * channels);
+	for (unsigned int i = 0; i < buffer.Frames; ++i)
+	{
+		double position = i * step;
+		unsigned int a = static_cast<unsigned int>(position);
+		unsigned int b = std::min(a + 1, sourceFrames - 1);
+		float t = static_cast<float>(position - a);
+		for (unsigned int c = 0; c < channels; ++c)
+		{
+			unsigned int sc = std::min(c, sourceChannels - 1);
+			float sa = source[a * sourceChannels + sc], sb = source[b * sourceChannels + sc];
+			buffer.Samples[i * channels + c] = static_cast<short>(sa + (sb - sa) * t);
+		}
+	}
+	return true;
+}
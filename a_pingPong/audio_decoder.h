@@ -0,0 +1,35 @@
+#ifndef AUDIO_DECODER_H
+#define AUDIO_DECODER_H
+
+#include <vector>
+
+
+// A sound effect, fully decoded to interleaved 16-bit PCM
+struct SoundBuffer {
+	std::vector<short> Samples;
+	unsigned int       Frames;
+};
+
+
+// AudioStream incrementally decodes an audio file to interleaved 16-bit
+// PCM in the file's own sample rate and channel count. WAV is always
+// supported; MP3 and Ogg Vorbis need the build to define
+// PINGPONG_HAVE_MPG123 and PINGPONG_HAVE_VORBIS respectively.
+class AudioStream
+{
+public:
+	// format of the decoded audio
+	unsigned int SampleRate, Channels;
+	virtual ~AudioStream() { }
+	// decodes up to frames frames into out; returns the number decoded, 0 at the end of the file
+	virtual unsigned int Read(short *out, unsigned int frames) = 0;
+	// seeks back to the first frame
+	virtual bool Rewind() = 0;
+};
+
+// opens a stream for the given file (picked by extension), or returns nullptr
+AudioStream *OpenAudioStream(const char *file);
+// decodes a whole file, converting it to the given sample rate and channel count
+bool DecodeSoundFile(const char *file, unsigned int sampleRate, unsigned int channels, SoundBuffer &buffer);
+
+#endif
@@ -0,0 +1,290 @@
+#include "audio_engine.h"
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+
+
+// how long the streaming thread sleeps when the music queue is full (a block lasts about 23 ms)
+static const unsigned int STREAM_SLEEP_MS = 5;
+
+AudioEngine::AudioEngine()
+	: musicTrack(0), musicRequests(0), mixedFrames(0), stats(), voiceCount(0), musicBlockCursor(0), musicPlaying(0), musicEnded(false), musicFrames(),
+	  musicPosition(0.0), output(nullptr), running(false)
+{
+	this->musicBlock.Frames = this->musicBlock.Track = 0;
+	this->musicBlock.SampleRate = SAMPLE_RATE;
+	this->musicBlock.Volume = 0.0f;
+	this->music.Stream = nullptr;
+}
+
+AudioEngine::~AudioEngine()
+{
+	this->Stop();
+}
+
+SoundHandle AudioEngine::LoadSound(const char *file)
+{
+	if (this->running)
+	{
+		std::cout << "ERROR::AUDIO: Sounds must be loaded before the mixer starts: " << file << std::endl;
+		return INVALID_SOUND;
+	}
+	SoundBuffer buffer;
+	if (!DecodeSoundFile(file, SAMPLE_RATE, CHANNELS, buffer))
+	{
+		std::cout << "ERROR::AUDIO: Failed to decode sound: " << file << std::endl;
+		++this->stats.Unloaded;
+		return INVALID_SOUND;
+	}
+	this->sounds.push_back(buffer);
+	return static_cast<SoundHandle>(this->sounds.size() - 1);
+}
+
+void AudioEngine::Start(AudioOutput *output)
+{
+	this->Stop();
+	this->output = output;
+	this->accumulator.reserve(PERIOD_FRAMES * CHANNELS);
+	this->running = true;
+	this->mixer = std::thread(&AudioEngine::mixerLoop, this);
+	this->streamer = std::thread(&AudioEngine::streamerLoop, this);
+}
+
+void AudioEngine::Stop()
+{
+	this->running = false;
+	if (this->mixer.joinable())
+		this->mixer.join();
+	if (this->streamer.joinable())
+		this->streamer.join();
+	if (this->output)
+	{
+		this->output->Close();
+		delete this->output;
+		this->output = nullptr;
+	}
+	this->voiceCount = 0;
+	// drop music, including any requests and blocks nobody picked up
+	delete this->music.Stream;
+	this->music.Stream = nullptr;
+	Music pending;
+	while (this->musicCommands.Pop(pending))
+		delete pending.Stream;
+	while (this->musicBlocks.Pop(this->musicBlock))
+		;
+	this->musicBlock.Frames = this->musicBlockCursor = 0;
+	this->musicTrack = this->musicPlaying = 0;
+}
+
+void AudioEngine::Play(SoundHandle sound, float volume)
+{
+	if (sound >= this->sounds.size())
+	{
+		++this->stats.Missing;
+		return;
+	}
+	Command command = { sound, volume, this->mixedFrames.load(std::memory_order_relaxed) };
+	// if the mixer has fallen 64 triggers behind, dropping one is inaudible
+	if (this->commands.Push(command))
+		++this->stats.Triggered;
+	else
+		++this->stats.Dropped;
+}
+
+void AudioEngine::PlayMusic(const char *file, bool loop, float volume)
+{
+	// opening only reads the file header; decoding happens on the streaming thread
+	Music request = { OpenAudioStream(file), ++this->musicRequests, loop, volume };
+	if (!request.Stream)
+		return;
+	// announced before the request is queued, so the mixer never drops a block of the new track
+	unsigned int previous = this->musicTrack.exchange(request.Track);
+	if (!this->musicCommands.Push(request))
+	{
+		this->musicTrack = previous;
+		delete request.Stream;
+	}
+}
+
+void AudioEngine::Mix(short *out, unsigned int frames)
+{
+	// without the threads, decode the music here
+	if (!this->running)
+		while (this->streamMusic())
+			;
+	// start newly triggered voices, stealing the one closest to finishing when full
+	Command command;
+	unsigned int position = this->mixedFrames.load(std::memory_order_relaxed);
+	while (this->commands.Pop(command))
+	{
+		Voice voice = { command.Sound, 0, command.Volume };
+		++this->stats.Started;
+		this->stats.MaxTriggerFrames = std::max(this->stats.MaxTriggerFrames, position - command.Position);
+		if (this->voiceCount < MAX_VOICES)
+			this->voices[this->voiceCount++] = voice;
+		else
+		{
+			unsigned int closest = 0;
+			for (unsigned int i = 1; i < this->voiceCount; ++i)
+				if (this->sounds[this->voices[i].Sound].Frames - this->voices[i].Cursor
+					< this->sounds[this->voices[closest].Sound].Frames - this->voices[closest].Cursor)
+					closest = i;
+			this->voices[closest] = voice;
+			++this->stats.Stolen;
+		}
+	}
+	// sum all voices in 32 bits, then clip once
+	this->accumulator.assign(frames * CHANNELS, 0);
+	this->mixMusic(frames);
+	for (unsigned int v = 0; v < this->voiceCount; )
+	{
+		Voice &voice = this->voices[v];
+		const SoundBuffer &sound = this->sounds[voice.Sound];
+		unsigned int count = std::min(frames, sound.Frames - voice.Cursor);
+		const short *source = &sound.Samples[voice.Cursor * CHANNELS];
+		int gain = static_cast<int>(voice.Volume * 256.0f);
+		for (unsigned int i = 0; i < count * CHANNELS; ++i)
+			this->accumulator[i] += (source[i] * gain) >> 8;
+		voice.Cursor += count;
+		// finished voices are swapped out with the last one
+		if (voice.Cursor >= sound.Frames)
+			this->voices[v] = this->voices[--this->voiceCount];
+		else
+			++v;
+	}
+	for (unsigned int i = 0; i < frames * CHANNELS; ++i)
+		out[i] = static_cast<short>(std::max(-32768, std::min(32767, this->accumulator[i])));
+	this->mixedFrames.store(position + frames, std::memory_order_relaxed);
+}
+
+void AudioEngine::mixerLoop()
+{
+	// opening a device can take hundreds of milliseconds, which is why it happens here and not in Start
+	if (!this->output->Open(SAMPLE_RATE, CHANNELS, PERIOD_FRAMES))
+	{
+		// keep the game running silently rather than failing
+		delete this->output;
+		this->output = new NullAudioOutput();
+		this->output->Open(SAMPLE_RATE, CHANNELS, PERIOD_FRAMES);
+	}
+	std::vector<short> period(PERIOD_FRAMES * CHANNELS);
+	while (this->running)
+	{
+		this->Mix(&period[0], PERIOD_FRAMES);
+		// blocks until the output has room, which paces this loop
+		this->output->Write(&period[0], PERIOD_FRAMES);
+	}
+}
+
+void AudioEngine::streamerLoop()
+{
+	while (this->running)
+		if (!this->streamMusic())
+			std::this_thread::sleep_for(std::chrono::milliseconds(STREAM_SLEEP_MS));
+}
+
+bool AudioEngine::streamMusic()
+{
+	Music request;
+	while (this->musicCommands.Pop(request))
+	{
+		delete this->music.Stream;
+		this->music = request;
+		this->musicDecoded.resize(MUSIC_BLOCK_FRAMES * request.Stream->Channels);
+	}
+	AudioStream *stream = this->music.Stream;
+	if (!stream || this->musicBlocks.Size() == MUSIC_BLOCKS)
+		return false;
+	unsigned int frames = stream->Read(&this->musicDecoded[0], MUSIC_BLOCK_FRAMES);
+	if (frames == 0 && this->music.Loop && stream->Rewind())
+		frames = stream->Read(&this->musicDecoded[0], MUSIC_BLOCK_FRAMES);
+	// convert to the mixer's channels here, so the mixer only copies
+	MusicBlock &block = this->streamBlock;
+	block.Frames = frames;
+	block.Track = this->music.Track;
+	block.SampleRate = stream->SampleRate;
+	block.Volume = this->music.Volume;
+	for (unsigned int i = 0; i < frames; ++i)
+		for (unsigned int c = 0; c < CHANNELS; ++c)
+			block.Samples[i * CHANNELS + c] = this->musicDecoded[i * stream->Channels + std::min(c, stream->Channels - 1)];
+	// only this thread pushes, and there was room
+	this->musicBlocks.Push(block);
+	if (frames == 0)
+	{
+		delete this->music.Stream;
+		this->music.Stream = nullptr;
+	}
+	return true;
+}
+
+void AudioEngine::mixMusic(unsigned int frames)
+{
+	unsigned int track = this->musicTrack.load();
+	if (track != this->musicPlaying)
+	{
+		// a new track (or none): start from silence
+		this->musicPlaying = track;
+		this->musicEnded = false;
+		this->musicBlock.Frames = this->musicBlockCursor = 0;
+		this->musicBlock.Track = track;
+		this->musicBlock.SampleRate = SAMPLE_RATE;
+		this->musicBlock.Volume = 0.0f;
+		this->musicPosition = 0.0;
+		std::fill(&this->musicFrames[0][0], &this->musicFrames[0][0] + 2 * CHANNELS, 0.0f);
+	}
+	if (track == 0 || this->musicEnded)
+		return;
+	// linearly resample from the stream's rate to the mixer rate
+	for (unsigned int i = 0; i < frames; ++i)
+	{
+		float t = static_cast<float>(this->musicPosition);
+		float gain = this->musicBlock.Volume * 32767.0f;
+		for (unsigned int c = 0; c < CHANNELS; ++c)
+		{
+			float a = this->musicFrames[0][c], b = this->musicFrames[1][c];
+			this->accumulator[i * CHANNELS + c] += static_cast<int>((a + (b - a) * t) * gain);
+		}
+		this->musicPosition += this->musicBlock.SampleRate > 0 ? static_cast<double>(this->musicBlock.SampleRate) / SAMPLE_RATE : 1.0;
+		while (this->musicPosition >= 1.0)
+		{
+			this->musicPosition -= 1.0;
+			if (!this->nextMusicFrame())
+			{
+				this->musicEnded = true;
+				return;
+			}
+		}
+	}
+}
+
+bool AudioEngine::nextMusicFrame()
+{
+	if (this->musicBlockCursor == this->musicBlock.Frames)
+	{
+		// the next block of the track; blocks of tracks replaced since are dropped
+		bool found = false;
+		MusicBlock &block = this->musicBlock;
+		while (!found && this->musicBlocks.Pop(block))
+			found = block.Track == this->musicPlaying;
+		this->musicBlockCursor = 0;
+		if (found && block.Frames == 0)
+			return false;
+		if (!found)
+		{
+			// the streaming thread fell behind: play silence rather than wait for it
+			block.Frames = 0;
+			block.Track = this->musicPlaying;
+			std::fill(&this->musicFrames[0][0], &this->musicFrames[0][0] + 2 * CHANNELS, 0.0f);
+			return true;
+		}
+	}
+	// shift the interpolation window along by one source frame
+	const short *frame = &this->musicBlock.Samples[this->musicBlockCursor++ * CHANNELS];
+	for (unsigned int c = 0; c < CHANNELS; ++c)
+	{
+		this->musicFrames[0][c] = this->musicFrames[1][c];
+		this->musicFrames[1][c] = frame[c] / 32768.0f;
+	}
+	return true;
+}
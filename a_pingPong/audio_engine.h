@@ -0,0 +1,135 @@
+#ifndef AUDIO_ENGINE_H
+#define AUDIO_ENGINE_H
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "audio_decoder.h"
+#include "audio_output.h"
+#include "spsc_queue.h"
+
+// Handle to a sound loaded into the AudioEngine
+typedef unsigned int SoundHandle;
+// Returned by AudioEngine::LoadSound if the sound could not be decoded
+const SoundHandle INVALID_SOUND = 0xFFFFFFFF;
+
+// What became of the effects triggered so far
+struct AudioStats {
+	unsigned int Triggered;         // Play calls queued for the mixer
+	unsigned int Dropped;           // Play calls lost to a full queue
+	unsigned int Started;           // voices the mixer started
+	unsigned int Stolen;            // voices cut short to make room for a new one
+	unsigned int MaxTriggerFrames;  // most frames mixed between a Play call and the mix its voice starts in
+	unsigned int Unloaded;          // LoadSound calls that failed (say, no decoder for the format)
+	unsigned int Missing;           // Play calls for a sound that did not load
+};
+
+
+// AudioEngine plays short sound effects with low latency. Effects are
+// decoded to PCM once at load time; Play only pushes a command onto a
+// lock-free queue which a dedicated mixer thread drains every period
+// (PERIOD_FRAMES, about 3 ms) before writing the mix to its AudioOutput.
+// The output is opened on the mixer thread, so a slow device never holds
+// up the first frame. Music is decoded ahead by a streaming thread into a
+// queue of blocks, so the mixer never waits on the disk or the decoder.
+class AudioEngine
+{
+public:
+	// mixer format
+	static const unsigned int SAMPLE_RATE = 44100;
+	static const unsigned int CHANNELS = 2;
+	static const unsigned int PERIOD_FRAMES = 128;
+	// maximum number of effects playing at the same time
+	static const unsigned int MAX_VOICES = 32;
+	// music frames per decoded block, and blocks decoded ahead (about 370 ms at 44.1 kHz)
+	static const unsigned int MUSIC_BLOCK_FRAMES = 1024;
+	static const unsigned int MUSIC_BLOCKS = 16;
+	// constructor/destructor
+	AudioEngine();
+	~AudioEngine();
+	// decodes a sound effect to PCM; must be called before Start
+	SoundHandle LoadSound(const char *file);
+	// starts the mixer and streaming threads; the mixer then opens the output (taking ownership of it)
+	void Start(AudioOutput *output);
+	// stops the threads and closes the output
+	void Stop();
+	// triggers a loaded sound effect; safe to call every frame from the game thread
+	void Play(SoundHandle sound, float volume = 1.0f);
+	// streams a music file from disk, replacing any music already playing
+	void PlayMusic(const char *file, bool loop, float volume = 1.0f);
+	// mixes the next frames of audio into out; called by the mixer thread, or directly when no thread
+	// is started (it then also decodes the music the streaming thread would have)
+	void Mix(short *out, unsigned int frames);
+	// trigger statistics; exact once the mixer thread is stopped, or when Mix is called directly
+	const AudioStats &Stats() const { return this->stats; }
+private:
+	// a request from the game thread to the mixer thread
+	struct Command {
+		SoundHandle  Sound;
+		float        Volume;
+		unsigned int Position;   // mixedFrames when Play was called
+	};
+	// an effect currently being mixed
+	struct Voice {
+		SoundHandle  Sound;
+		unsigned int Cursor;
+		float        Volume;
+	};
+	// a streamed music track
+	struct Music {
+		AudioStream *Stream;
+		unsigned int Track;
+		bool         Loop;
+		float        Volume;
+	};
+	// decoded music, already converted to the mixer's channels; the block with no frames ends its track
+	struct MusicBlock {
+		short        Samples[MUSIC_BLOCK_FRAMES * CHANNELS];
+		unsigned int Frames;
+		unsigned int Track;
+		unsigned int SampleRate;
+		float        Volume;
+	};
+	// sound storage; read-only once the mixer has started
+	std::vector<SoundBuffer> sounds;
+	// game thread -> mixer thread
+	SpscQueue<Command, 64> commands;
+	// game thread -> streaming thread -> mixer thread
+	SpscQueue<Music, 4>    musicCommands;
+	SpscQueue<MusicBlock, MUSIC_BLOCKS> musicBlocks;
+	// the track last requested (0 = none): the mixer drops blocks of older ones
+	std::atomic<unsigned int> musicTrack;
+	unsigned int         musicRequests;
+	// frames mixed so far (written by the mixer only)
+	std::atomic<unsigned int> mixedFrames;
+	// Started, Stolen and MaxTriggerFrames are counted by the mixer, the rest by the game thread
+	AudioStats           stats;
+	// mixer thread state
+	Voice                voices[MAX_VOICES];
+	unsigned int         voiceCount;
+	std::vector<int>     accumulator;
+	MusicBlock           musicBlock;
+	unsigned int         musicBlockCursor, musicPlaying;
+	bool                 musicEnded;
+	float                musicFrames[2][CHANNELS];
+	double               musicPosition;
+	// streaming thread state
+	Music                music;
+	std::vector<short>   musicDecoded;
+	MusicBlock           streamBlock;
+	AudioOutput         *output;
+	std::thread          mixer, streamer;
+	std::atomic<bool>    running;
+	// thread bodies
+	void mixerLoop();
+	void streamerLoop();
+	// mixes the streamed music into the accumulator
+	void mixMusic(unsigned int frames);
+	// advances the music by one source frame; returns false once it has ended
+	bool nextMusicFrame();
+	// decodes the next block of music into musicBlocks; returns false if there was nothing to do
+	bool streamMusic();
+};
+
+#endif
@@ -0,0 +1,292 @@
+#include "audio_output.h"
+
+#include <cstring>
+#include <iostream>
+#include <thread>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#include <mmsystem.h>
+#endif
+#ifdef PINGPONG_HAVE_ALSA
+#include <alsa/asoundlib.h>
+#endif
+
+
+NullAudioOutput::NullAudioOutput()
+	: sampleRate(44100), framesWritten(0) { }
+
+bool NullAudioOutput::Open(unsigned int sampleRate, unsigned int, unsigned int)
+{
+	this->sampleRate = sampleRate;
+	this->framesWritten = 0;
+	this->start = std::chrono::steady_clock::now();
+	return true;
+}
+
+void NullAudioOutput::Write(const short *, unsigned int frames)
+{
+	this->pace(frames);
+}
+
+void NullAudioOutput::Close()
+{
+
+}
+
+void NullAudioOutput::pace(unsigned int frames)
+{
+	// sleep until the frames written so far would have finished playing
+	this->framesWritten += frames;
+	std::chrono::microseconds played(this->framesWritten * 1000000ull / this->sampleRate);
+	std::this_thread::sleep_until(this->start + played);
+}
+
+
+WavFileAudioOutput::WavFileAudioOutput(std::string path)
+	: path(path), file(nullptr), sampleRate(44100), channels(2), dataBytes(0) { }
+
+WavFileAudioOutput::~WavFileAudioOutput()
+{
+	this->Close();
+}
+
+bool WavFileAudioOutput::Open(unsigned int sampleRate, unsigned int channels, unsigned int periodFrames)
+{
+	this->file = fopen(this->path.c_str(), "wb");
+	if (!this->file)
+	{
+		std::cout << "ERROR::AUDIO: Failed to open wav output: " << this->path << std::endl;
+		return false;
+	}
+	this->sampleRate = sampleRate;
+	this->channels = channels;
+	this->dataBytes = 0;
+	this->writeHeader();
+	return NullAudioOutput::Open(sampleRate, channels, periodFrames);
+}
+
+void WavFileAudioOutput::Write(const short *samples, unsigned int frames)
+{
+	unsigned int bytes = frames * this->channels * sizeof(short);
+	fwrite(samples, 1, bytes, this->file);
+	this->dataBytes += bytes;
+	this->pace(frames);
+}
+
+void WavFileAudioOutput::Close()
+{
+	if (!this->file)
+		return;
+	// patch the sizes now that the length is known
+	fseek(this->file, 0, SEEK_SET);
+	this->writeHeader();
+	fclose(this->file);
+	this->file = nullptr;
+}
+
+void WavFileAudioOutput::writeHeader()
+{
+	unsigned int byteRate = this->sampleRate * this->channels * sizeof(short);
+	unsigned short blockAlign = static_cast<unsigned short>(this->channels * sizeof(short));
+	unsigned short channelCount = static_cast<unsigned short>(this->channels);
+	unsigned short format = 1, bits = 16;
+	unsigned int fmtSize = 16, riffSize = 36 + this->dataBytes;
+	// the canonical 44 byte header, little-endian like the hosts we run on
+	fwrite("RIFF", 1, 4, this->file);
+	fwrite(&riffSize, 4, 1, this->file);
+	fwrite("WAVEfmt ", 1, 8, this->file);
+	fwrite(&fmtSize, 4, 1, this->file);
+	fwrite(&format, 2, 1, this->file);
+	fwrite(&channelCount, 2, 1, this->file);
+	fwrite(&this->sampleRate, 4, 1, this->file);
+	fwrite(&byteRate, 4, 1, this->file);
+	fwrite(&blockAlign, 2, 1, this->file);
+	fwrite(&bits, 2, 1, this->file);
+	fwrite("data", 1, 4, this->file);
+	fwrite(&this->dataBytes, 4, 1, this->file);
+}
+
+
+BufferAudioOutput::BufferAudioOutput(unsigned int maxFrames, bool realTime)
+	: maxFrames(maxFrames), channels(2), realTime(realTime) { }
+
+bool BufferAudioOutput::Open(unsigned int sampleRate, unsigned int channels, unsigned int periodFrames)
+{
+	std::lock_guard<std::mutex> guard(this->lock);
+	this->channels = channels;
+	this->samples.clear();
+	this->samples.reserve(this->maxFrames * channels);
+	return NullAudioOutput::Open(sampleRate, channels, periodFrames);
+}
+
+void BufferAudioOutput::Write(const short *samples, unsigned int frames)
+{
+	{
+		std::lock_guard<std::mutex> guard(this->lock);
+		unsigned int room = this->maxFrames - static_cast<unsigned int>(this->samples.size() / this->channels);
+		unsigned int count = frames < room ? frames : room;
+		this->samples.insert(this->samples.end(), samples, samples + count * this->channels);
+	}
+	if (this->realTime)
+		this->pace(frames);
+}
+
+std::vector<short> BufferAudioOutput::Captured()
+{
+	std::lock_guard<std::mutex> guard(this->lock);
+	return this->samples;
+}
+
+
+#ifdef PINGPONG_HAVE_ALSA
+AlsaAudioOutput::AlsaAudioOutput(std::string device)
+	: device(device), pcm(nullptr), channels(2) { }
+
+AlsaAudioOutput::~AlsaAudioOutput()
+{
+	this->Close();
+}
+
+bool AlsaAudioOutput::Open(unsigned int sampleRate, unsigned int channels, unsigned int periodFrames)
+{
+	snd_pcm_t *handle;
+	int error = snd_pcm_open(&handle, this->device.c_str(), SND_PCM_STREAM_PLAYBACK, 0);
+	if (error < 0)
+	{
+		std::cout << "ERROR::AUDIO: Failed to open ALSA device " << this->device << ": " << snd_strerror(error) << std::endl;
+		return false;
+	}
+	// ask for roughly two periods of buffering, the same depth as the waveOut backend
+	unsigned int latency = static_cast<unsigned int>(2ull * periodFrames * 1000000ull / sampleRate);
+	error = snd_pcm_set_params(handle, SND_PCM_FORMAT_S16_LE, SND_PCM_ACCESS_RW_INTERLEAVED, channels, sampleRate, 1, latency);
+	if (error < 0)
+	{
+		std::cout << "ERROR::AUDIO: Failed to configure ALSA device: " << snd_strerror(error) << std::endl;
+		snd_pcm_close(handle);
+		return false;
+	}
+	this->pcm = handle;
+	this->channels = channels;
+	return true;
+}
+
+void AlsaAudioOutput::Write(const short *samples, unsigned int frames)
+{
+	snd_pcm_t *handle = static_cast<snd_pcm_t*>(this->pcm);
+	while (frames > 0)
+	{
+		snd_pcm_sframes_t written = snd_pcm_writei(handle, samples, frames);
+		if (written < 0)
+		{
+			// recover from underruns and suspends; give up on this period otherwise
+			if (snd_pcm_recover(handle, static_cast<int>(written), 1) < 0)
+				return;
+			continue;
+		}
+		samples += written * this->channels;
+		frames -= static_cast<unsigned int>(written);
+	}
+}
+
+void AlsaAudioOutput::Close()
+{
+	if (!this->pcm)
+		return;
+	snd_pcm_close(static_cast<snd_pcm_t*>(this->pcm));
+	this->pcm = nullptr;
+}
+#endif
+
+
+#ifdef _WIN32
+WaveOutAudioOutput::WaveOutAudioOutput()
+	: device(nullptr), event(nullptr), headers(), buffers(), channels(2), next(0) { }
+
+WaveOutAudioOutput::~WaveOutAudioOutput()
+{
+	this->Close();
+}
+
+bool WaveOutAudioOutput::Open(unsigned int sampleRate, unsigned int channels, unsigned int periodFrames)
+{
+	WAVEFORMATEX format = {};
+	format.wFormatTag = WAVE_FORMAT_PCM;
+	format.nChannels = static_cast<WORD>(channels);
+	format.nSamplesPerSec = sampleRate;
+	format.wBitsPerSample = 16;
+	format.nBlockAlign = static_cast<WORD>(channels * sizeof(short));
+	format.nAvgBytesPerSec = sampleRate * format.nBlockAlign;
+	// the device signals this event every time it finishes a buffer
+	this->event = CreateEvent(nullptr, FALSE, FALSE, nullptr);
+	HWAVEOUT handle;
+	if (waveOutOpen(&handle, WAVE_MAPPER, &format, (DWORD_PTR)this->event, 0, CALLBACK_EVENT) != MMSYSERR_NOERROR)
+	{
+		std::cout << "ERROR::AUDIO: Failed to open waveOut device" << std::endl;
+		CloseHandle(this->event);
+		this->event = nullptr;
+		return false;
+	}
+	this->device = handle;
+	this->channels = channels;
+	this->next = 0;
+	for (unsigned int i = 0; i < BUFFER_COUNT; ++i)
+	{
+		this->buffers[i] = new short[periodFrames * channels]();
+		WAVEHDR *header = new WAVEHDR();
+		header->lpData = reinterpret_cast<LPSTR>(this->buffers[i]);
+		header->dwBufferLength = periodFrames * channels * sizeof(short);
+		waveOutPrepareHeader(handle, header, sizeof(WAVEHDR));
+		// mark as done so the first Write calls can use it straight away
+		header->dwFlags |= WHDR_DONE;
+		this->headers[i] = header;
+	}
+	return true;
+}
+
+void WaveOutAudioOutput::Write(const short *samples, unsigned int frames)
+{
+	WAVEHDR *header = static_cast<WAVEHDR*>(this->headers[this->next]);
+	// wait for the device to hand this buffer back
+	while (!(header->dwFlags & WHDR_DONE))
+		WaitForSingleObject(this->event, INFINITE);
+	memcpy(header->lpData, samples, frames * this->channels * sizeof(short));
+	header->dwBufferLength = frames * this->channels * sizeof(short);
+	header->dwFlags &= ~WHDR_DONE;
+	waveOutWrite(static_cast<HWAVEOUT>(this->device), header, sizeof(WAVEHDR));
+	this->next = (this->next + 1) % BUFFER_COUNT;
+}
+
+void WaveOutAudioOutput::Close()
+{
+	if (!this->device)
+		return;
+	HWAVEOUT handle = static_cast<HWAVEOUT>(this->device);
+	waveOutReset(handle);
+	for (unsigned int i = 0; i < BUFFER_COUNT; ++i)
+	{
+		WAVEHDR *header = static_cast<WAVEHDR*>(this->headers[i]);
+		waveOutUnprepareHeader(handle, header, sizeof(WAVEHDR));
+		delete header;
+		delete[] this->buffers[i];
+	}
+	waveOutClose(handle);
+	CloseHandle(this->event);
+	this->device = nullptr;
+	this->event = nullptr;
+}
+#endif
+
+
+AudioOutput *CreateDefaultAudioOutput()
+{
+#if defined(_WIN32)
+	return new WaveOutAudioOutput();
+#elif defined(PINGPONG_HAVE_ALSA)
+	return new AlsaAudioOutput();
+#else
+	return new NullAudioOutput();
+#endif
+}
@@ -0,0 +1,136 @@
+#ifndef AUDIO_OUTPUT_H
+#define AUDIO_OUTPUT_H
+
+#include <chrono>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <vector>
+
+
+// AudioOutput is the sink the mixer thread hands its mixed audio to, as
+// interleaved signed 16-bit PCM. Write blocks until the sink can accept
+// more audio, which is what paces the mixer thread.
+class AudioOutput
+{
+public:
+	virtual ~AudioOutput() { }
+	// opens the sink; periodFrames is the size of every Write call. Called
+	// from the mixer thread, so a slow device open never stalls a frame
+	virtual bool Open(unsigned int sampleRate, unsigned int channels, unsigned int periodFrames) = 0;
+	// queues a period of audio, blocking while the sink is full
+	virtual void Write(const short *samples, unsigned int frames) = 0;
+	// flushes and releases the sink
+	virtual void Close() = 0;
+};
+
+
+// Discards all audio, but consumes it at the real-time rate so the mixer
+// behaves as it would against a device.
+class NullAudioOutput : public AudioOutput
+{
+public:
+	NullAudioOutput();
+	bool Open(unsigned int sampleRate, unsigned int channels, unsigned int periodFrames) override;
+	void Write(const short *samples, unsigned int frames) override;
+	void Close() override;
+protected:
+	// sleeps until the given number of frames would have been played
+	void pace(unsigned int frames);
+private:
+	unsigned int sampleRate;
+	unsigned long long framesWritten;
+	std::chrono::steady_clock::time_point start;
+};
+
+
+// Writes all audio to a 16-bit PCM .wav file, paced in real time so the
+// file lines up with what would have been heard.
+class WavFileAudioOutput : public NullAudioOutput
+{
+public:
+	WavFileAudioOutput(std::string path);
+	~WavFileAudioOutput();
+	bool Open(unsigned int sampleRate, unsigned int channels, unsigned int periodFrames) override;
+	void Write(const short *samples, unsigned int frames) override;
+	void Close() override;
+private:
+	std::string path;
+	FILE *file;
+	unsigned int sampleRate, channels;
+	unsigned int dataBytes;
+	// (re)writes the RIFF header with the current data size
+	void writeHeader();
+};
+
+
+// Headless backend: collects the mixed audio in memory (up to a limit) so
+// tests and tools can inspect exactly what would have been played. Unless
+// realTime is set, Write returns at once, for a caller that drives
+// AudioEngine::Mix itself as fast as it likes.
+class BufferAudioOutput : public NullAudioOutput
+{
+public:
+	BufferAudioOutput(unsigned int maxFrames, bool realTime);
+	bool Open(unsigned int sampleRate, unsigned int channels, unsigned int periodFrames) override;
+	void Write(const short *samples, unsigned int frames) override;
+	// copies out everything captured so far, as interleaved samples
+	std::vector<short> Captured();
+private:
+	std::mutex         lock;
+	std::vector<short> samples;
+	unsigned int       maxFrames, channels;
+	bool               realTime;
+};
+
+
+#ifdef PINGPONG_HAVE_ALSA
+// Plays audio through an ALSA PCM device (PulseAudio and PipeWire both
+// provide the "default" ALSA device), with the hardware buffer sized for
+// low latency.
+class AlsaAudioOutput : public AudioOutput
+{
+public:
+	AlsaAudioOutput(std::string device = "default");
+	~AlsaAudioOutput();
+	bool Open(unsigned int sampleRate, unsigned int channels, unsigned int periodFrames) override;
+	void Write(const short *samples, unsigned int frames) override;
+	void Close() override;
+private:
+	std::string device;
+	void *pcm;
+	unsigned int channels;
+};
+#endif
+
+
+#ifdef _WIN32
+// Plays audio through the Windows waveOut API using a small ring of
+// period-sized buffers, which bounds the output latency.
+class WaveOutAudioOutput : public AudioOutput
+{
+public:
+	WaveOutAudioOutput();
+	~WaveOutAudioOutput();
+	bool Open(unsigned int sampleRate, unsigned int channels, unsigned int periodFrames) override;
+	void Write(const short *samples, unsigned int frames) override;
+	void Close() override;
+private:
+	// number of periods queued on the device; BUFFER_COUNT * period is the output latency, and a
+	// trigger waits at most one more period for the next mix (under 9 ms in all at 128 frames)
+	static const unsigned int BUFFER_COUNT = 2;
+	void *device;
+	void *event;
+	void *headers[BUFFER_COUNT];
+	short *buffers[BUFFER_COUNT];
+	unsigned int channels;
+	unsigned int next;
+};
+#endif
+
+
+// returns the output for the platform's default sound device, or a
+// NullAudioOutput if the platform has no device backend
+AudioOutput *CreateDefaultAudioOutput();
+
+#endif
@@ -1,40 +0,0 @@
-#include "ball_object.h"
-
-
-BallObject::BallObject()
-	: GameObject(), Radius(12.5f), Stuck(true) { }
-
-BallObject::BallObject(glm::vec2 pos, float radius, glm::vec2 velocity, Texture2D sprite)
-	: GameObject(pos, glm::vec2(radius * 2.0f, radius * 2.0f), sprite, glm::vec3(1.0f), velocity), Radius(radius), Stuck(true) { }
-
-glm::vec2 BallObject::Move(float dt, unsigned int window_height, bool isPlayer1)
-{
-	// if not stuck to player board
-	if (!this->Stuck)
-	{
-		// move the ball
-		if (isPlayer1) this->Position -= this->Velocity * dt; 
-		else this->Position += this->Velocity * dt;
-		// check if outside window bounds; if so, reverse velocity and restore at correct position
-		if (this->Position.y <= 0.0f)
-		{
-			this->Velocity.y = -this->Velocity.y;
-			this->Position.y = 0.0f;
-		}
-		else if (this->Position.y + this->Size.y >= window_height)
-		{
-			this->Velocity.y = -this->Velocity.y;
-			this->Position.y = window_height - this->Size.y;
-		}
-	}
-	return this->Position;
-}
-
-// resets the ball to initial Stuck Position (if ball is outside window bounds)
-void BallObject::Reset(glm::vec2 position, glm::vec2 velocity)
-{
-	this->Position = position;
-	this->Velocity = velocity;
-	this->Stuck = true;
-
-}
\ No newline at end of file
@@ -1,31 +0,0 @@
-#ifndef BALLOBJECT_H
-#define BALLOBJECT_H
-
-#include <glad/glad.h>
-#include <glm/glm.hpp>
-
-#include "game_object.h"
-#include "texture.h"
-
-
-// BallObject holds the state of the Ball object inheriting
-// relevant state data from GameObject. Contains some extra
-// functionality specific to Breakout's ball object that
-// were too specific for within GameObject alone.
-class BallObject : public GameObject
-{
-public:
-	// ball state	
-	float   Radius;
-	bool    Stuck;
-
-	// constructor(s)
-	BallObject();
-	BallObject(glm::vec2 pos, float radius, glm::vec2 velocity, Texture2D sprite);
-	// moves the ball, keeping it constrained within the window bounds (except bottom edge); returns new position
-	glm::vec2 Move(float dt, unsigned int window_height, bool isPlayer1);
-	// resets the ball to original state with given position and velocity
-	void      Reset(glm::vec2 position, glm::vec2 velocity);
-};
-
-#endif
\ No newline at end of file
@@ -0,0 +1,181 @@
+#include "batch_sim.h"
+#include "game.h"
+#include "job_system.h"
+
+#include <algorithm>
+#include <cmath>
+
+// the arena of main.cpp and headless_main.cpp
+const unsigned int ARENA_WIDTH = 900, ARENA_HEIGHT = 600;
+// serve speeds of the built-in difficulties (levels/amateur.lvl to levels/world_class.lvl)
+constexpr float DIFFICULTY_SPEEDS[] = { 4.0f, 6.5f, 9.0f, 12.0f };
+
+// Rules as compile-time constants: a kernel instantiated with them folds them
+// into its arithmetic instead of loading them from BatchRules every tick.
+template <unsigned int Difficulty, unsigned int Rate, unsigned int ArenaWidth, unsigned int ArenaHeight>
+struct CompiledRules {
+	static constexpr float        Speed = DIFFICULTY_SPEEDS[Difficulty];
+	static constexpr unsigned int TickRate = Rate;
+	static constexpr float        Width = ArenaWidth, Height = ArenaHeight;
+	static constexpr float        BallRadius = BALL_RADIUS, PaddleWidth = PLAYER_WIDTH, PaddleHeight = PLAYER_HEIGHT;
+};
+template <unsigned int D, unsigned int R, unsigned int W, unsigned int H> constexpr float        CompiledRules<D, R, W, H>::Speed;
+template <unsigned int D, unsigned int R, unsigned int W, unsigned int H> constexpr unsigned int CompiledRules<D, R, W, H>::TickRate;
+template <unsigned int D, unsigned int R, unsigned int W, unsigned int H> constexpr float        CompiledRules<D, R, W, H>::Width;
+template <unsigned int D, unsigned int R, unsigned int W, unsigned int H> constexpr float        CompiledRules<D, R, W, H>::Height;
+template <unsigned int D, unsigned int R, unsigned int W, unsigned int H> constexpr float        CompiledRules<D, R, W, H>::BallRadius;
+template <unsigned int D, unsigned int R, unsigned int W, unsigned int H> constexpr float        CompiledRules<D, R, W, H>::PaddleWidth;
+template <unsigned int D, unsigned int R, unsigned int W, unsigned int H> constexpr float        CompiledRules<D, R, W, H>::PaddleHeight;
+
+// matches a kernel works on at once; their lanes are copied to the stack, where the compiler
+// can tell the arrays apart without run-time alias checks and they stay in the L1 cache
+const unsigned int KERNEL_LANES = 256;
+
+// one tick of Game::Autopilot, ProcessInput and Update for the matches [begin, end), repeated
+// for every tick; Rules is either BatchRules or a CompiledRules. The body has no branches
+// that depend on the match, only selects, so the compiler can run it over several lanes at once.
+template <typename Rules>
+static void stepMatches(BatchSimulator &batch, const Rules &rules, unsigned int ticks, unsigned int begin, unsigned int end)
+{
+	const float dt = 1.0f / rules.TickRate;
+	const float radius = rules.BallRadius, diameter = 2.0f * rules.BallRadius;
+	const float halfWidth = rules.PaddleWidth / 2.0f, halfHeight = rules.PaddleHeight / 2.0f;
+	const float paddleStep = PLAYER_VELOCITY * dt, paddleTop = rules.Height / 2.0f - halfHeight;
+	const float serve = rules.Speed * INITIAL_BALL_SPEED;
+	// player 1 defends the right edge, player 2 the left one
+	const float paddleX[2] = { rules.Width - rules.PaddleWidth - 5.0f, 5.0f };
+	for (unsigned int first = begin; first < end; first += KERNEL_LANES)
+	{
+		unsigned int count = std::min(end - first, KERNEL_LANES);
+		float ballX[KERNEL_LANES], ballY[KERNEL_LANES], velocityX[KERNEL_LANES], velocityY[KERNEL_LANES];
+		float direction[KERNEL_LANES], paddle1[KERNEL_LANES], paddle2[KERNEL_LANES];
+		unsigned int score1[KERNEL_LANES], score2[KERNEL_LANES], wins1[KERNEL_LANES], wins2[KERNEL_LANES], hits[KERNEL_LANES];
+		float *floats[] = { ballX, ballY, velocityX, velocityY, direction, paddle1, paddle2 };
+		std::vector<float> *floatLanes[] = { &batch.BallX, &batch.BallY, &batch.VelocityX, &batch.VelocityY,
+			&batch.Direction, &batch.Paddle1, &batch.Paddle2 };
+		unsigned int *counters[] = { score1, score2, wins1, wins2, hits };
+		std::vector<unsigned int> *counterLanes[] = { &batch.Score1, &batch.Score2, &batch.Wins1, &batch.Wins2, &batch.Hits };
+		for (unsigned int lane = 0; lane < 7; ++lane)
+			std::copy_n(floatLanes[lane]->data() + first, count, floats[lane]);
+		for (unsigned int lane = 0; lane < 5; ++lane)
+			std::copy_n(counterLanes[lane]->data() + first, count, counters[lane]);
+		for (unsigned int tick = 0; tick < ticks; ++tick)
+		{
+			for (unsigned int i = 0; i < count; ++i)
+			{
+				float x = ballX[i], y = ballY[i], vx = velocityX[i], vy = velocityY[i], dir = direction[i];
+				float paddle[2] = { paddle1[i], paddle2[i] };
+				unsigned int bounces = hits[i];
+				// autopilot: keep each paddle's center within a few pixels of the ball's
+				for (int p = 0; p < 2; ++p)
+				{
+					float center = paddle[p] + halfHeight;
+					bool up = (y + radius < center - 10.0f) & (paddle[p] >= 0.0f);
+					bool down = (y + radius > center + 10.0f) & (paddle[p] <= rules.Height - rules.PaddleHeight);
+					paddle[p] += (down ? paddleStep : 0.0f) - (up ? paddleStep : 0.0f);
+				}
+				// move the ball (the velocity is mirrored while player 1 serves) and bounce it off the top and bottom
+				x += dir * vx * dt;
+				y += dir * vy * dt;
+				bool top = y <= 0.0f, bottom = y + diameter >= rules.Height;
+				vy = top | bottom ? -vy : vy;
+				y = top ? 0.0f : bottom ? rules.Height - diameter : y;
+				// bounce off the paddles, steered by where the ball hit them
+				for (int p = 0; p < 2; ++p)
+				{
+					float centerX = paddleX[p] + halfWidth, centerY = paddle[p] + halfHeight;
+					float dx = std::min(std::max(x + radius - centerX, -halfWidth), halfWidth) + centerX - (x + radius);
+					float dy = std::min(std::max(y + radius - centerY, -halfHeight), halfHeight) + centerY - (y + radius);
+					bool hit = dx * dx + dy * dy < radius * radius;
+					float bounceX = -vx, bounceY = -INITIAL_BALL_SPEED * ((y + radius - centerY) / halfHeight) * 2.0f;
+					float scale = std::sqrt((vx * vx + vy * vy) / (bounceX * bounceX + bounceY * bounceY));
+					vx = hit ? bounceX * scale : vx;
+					vy = hit ? bounceY * scale : vy;
+					bounces += hit ? 1 : 0;
+				}
+				// a ball past an edge scores for the other player, and the loser serves from the middle
+				bool lost1 = x >= rules.Width, lost2 = !lost1 & (x <= 0.0f), served = lost1 | lost2;
+				score2[i] += lost1 ? 1 : 0;
+				score1[i] += lost2 ? 1 : 0;
+				paddle[0] = served ? paddleTop : paddle[0];
+				paddle[1] = served ? paddleTop : paddle[1];
+				x = lost1 ? paddleX[0] - diameter : lost2 ? paddleX[1] + diameter : x;
+				y = served ? rules.Height / 2.0f - radius : y;
+				vx = served ? serve : vx;
+				vy = served ? -serve : vy;
+				dir = lost1 ? -1.0f : lost2 ? 1.0f : dir;
+				// the next match starts as soon as one is won
+				bool won1 = score1[i] == WIN_SCORE, won2 = score2[i] == WIN_SCORE;
+				wins1[i] += won1 ? 1 : 0;
+				wins2[i] += won2 ? 1 : 0;
+				score1[i] = won1 | won2 ? 0 : score1[i];
+				score2[i] = won1 | won2 ? 0 : score2[i];
+				ballX[i] = x; ballY[i] = y;
+				velocityX[i] = vx; velocityY[i] = vy; direction[i] = dir;
+				paddle1[i] = paddle[0]; paddle2[i] = paddle[1]; hits[i] = bounces;
+			}
+		}
+		for (unsigned int lane = 0; lane < 7; ++lane)
+			std::copy_n(floats[lane], count, floatLanes[lane]->data() + first);
+		for (unsigned int lane = 0; lane < 5; ++lane)
+			std::copy_n(counters[lane], count, counterLanes[lane]->data() + first);
+	}
+}
+
+static void genericKernel(BatchSimulator &batch, const BatchRules &rules, unsigned int ticks, unsigned int begin, unsigned int end)
+{
+	stepMatches(batch, rules, ticks, begin, end);
+}
+
+template <unsigned int Difficulty, unsigned int TickRate>
+static void compiledKernel(BatchSimulator &batch, const BatchRules &, unsigned int ticks, unsigned int begin, unsigned int end)
+{
+	stepMatches(batch, CompiledRules<Difficulty, TickRate, ARENA_WIDTH, ARENA_HEIGHT>(), ticks, begin, end);
+}
+
+// the instantiated kernels: every built-in difficulty at the common tick rates
+struct CompiledKernel {
+	unsigned int          Difficulty, TickRate;
+	BatchSimulator::Kernel Function;
+};
+static const CompiledKernel COMPILED_KERNELS[] = {
+	{ 0,  60, compiledKernel<0,  60> }, { 0, 120, compiledKernel<0, 120> }, { 0, 240, compiledKernel<0, 240> },
+	{ 1,  60, compiledKernel<1,  60> }, { 1, 120, compiledKernel<1, 120> }, { 1, 240, compiledKernel<1, 240> },
+	{ 2,  60, compiledKernel<2,  60> }, { 2, 120, compiledKernel<2, 120> }, { 2, 240, compiledKernel<2, 240> },
+	{ 3,  60, compiledKernel<3,  60> }, { 3, 120, compiledKernel<3, 120> }, { 3, 240, compiledKernel<3, 240> },
+};
+
+BatchSimulator::BatchSimulator(unsigned int matches, const BatchRules &rules, bool generic)
+	: BallX(matches), BallY(matches), VelocityX(matches), VelocityY(matches), Direction(matches, -1.0f),
+	  Paddle1(matches), Paddle2(matches), Score1(matches), Score2(matches), Wins1(matches), Wins2(matches),
+	  Hits(matches), rules(rules), kernel(genericKernel), specialized(false)
+{
+	// pick the kernel compiled for these rules, if there is one
+	bool standard = rules.Width == ARENA_WIDTH && rules.Height == ARENA_HEIGHT && rules.BallRadius == BALL_RADIUS
+		&& rules.PaddleWidth == PLAYER_WIDTH && rules.PaddleHeight == PLAYER_HEIGHT;
+	for (const CompiledKernel &compiled : COMPILED_KERNELS)
+		if (!generic && standard && rules.Speed == DIFFICULTY_SPEEDS[compiled.Difficulty] && rules.TickRate == compiled.TickRate)
+		{
+			this->kernel = compiled.Function;
+			this->specialized = true;
+		}
+	// player 1 serves every match, each one at a different angle up to 30 degrees off the usual one
+	float serve = rules.Speed * INITIAL_BALL_SPEED;
+	for (unsigned int i = 0; i < matches; ++i)
+	{
+		float angle = 1.0471976f * (matches > 1 ? static_cast<float>(i) / (matches - 1) - 0.5f : 0.0f);
+		this->Paddle1[i] = this->Paddle2[i] = rules.Height / 2.0f - rules.PaddleHeight / 2.0f;
+		this->BallX[i] = rules.Width - rules.PaddleWidth - 5.0f - 2.0f * rules.BallRadius;
+		this->BallY[i] = rules.Height / 2.0f - rules.BallRadius;
+		this->VelocityX[i] = serve * std::cos(angle) + serve * std::sin(angle);
+		this->VelocityY[i] = serve * std::sin(angle) - serve * std::cos(angle);
+	}
+}
+
+void BatchSimulator::Step(unsigned int ticks)
+{
+	// chunks small enough for their lanes to stay in the cache over all the ticks
+	JobSystem::ParallelFor(this->Matches(), 1024, [this, ticks](unsigned int begin, unsigned int end) {
+		this->kernel(*this, this->rules, ticks, begin, end);
+	});
+}
@@ -0,0 +1,45 @@
+#ifndef BATCH_SIM_H
+#define BATCH_SIM_H
+
+#include <vector>
+
+// Rules every match of a batch is played by: the level's serve speed (as a
+// multiple of INITIAL_BALL_VELOCITY), ball and paddle sizes, the tick rate
+// and the arena size.
+struct BatchRules {
+	float        Speed;
+	unsigned int TickRate;
+	float        Width, Height;
+	float        BallRadius, PaddleWidth, PaddleHeight;
+};
+
+// BatchSimulator plays many independent single-ball matches between two
+// autopilot paddles, for balancing levels and generating training data.
+// The matches are stored as lanes of structure-of-arrays state and each
+// tick runs a kernel over all of them. Rules matching a built-in difficulty
+// and tick rate in the standard arena run a kernel compiled for exactly
+// those rules; any others run the generic kernel, which reads them at run
+// time. Speed curves and obstacles are not simulated.
+class BatchSimulator
+{
+public:
+	// match state, one lane per match
+	std::vector<float>        BallX, BallY, VelocityX, VelocityY, Direction, Paddle1, Paddle2;
+	std::vector<unsigned int> Score1, Score2;
+	// per-match totals
+	std::vector<unsigned int> Wins1, Wins2, Hits;
+	// constructor serves every match, each at a different angle; generic forces the generic kernel
+	BatchSimulator(unsigned int matches, const BatchRules &rules, bool generic = false);
+	// advances every match by the given number of ticks, in parallel on the job system
+	void Step(unsigned int ticks);
+	unsigned int Matches() const { return static_cast<unsigned int>(this->BallX.size()); }
+	// whether the rules run a compile-time specialized kernel
+	bool Specialized() const { return this->specialized; }
+	typedef void (*Kernel)(BatchSimulator &batch, const BatchRules &rules, unsigned int ticks, unsigned int begin, unsigned int end);
+private:
+	BatchRules rules;
+	Kernel     kernel;
+	bool       specialized;
+};
+
+#endif
@@ -0,0 +1,35 @@
+#include "entity_store.h"
+
+Entity EntityStore::Create()
+{
+	if (!this->freeIds.empty())
+	{
+		Entity entity = this->freeIds.back();
+		this->freeIds.pop_back();
+		return entity;
+	}
+	return this->next++;
+}
+
+void EntityStore::Destroy(Entity entity)
+{
+	this->Transforms.Remove(entity);
+	this->Kinematics.Remove(entity);
+	this->Colliders.Remove(entity);
+	this->Sprites.Remove(entity);
+	this->Scores.Remove(entity);
+	this->FixedBodies.Remove(entity);
+	this->freeIds.push_back(entity);
+}
+
+void EntityStore::Clear()
+{
+	this->Transforms.Clear();
+	this->Kinematics.Clear();
+	this->Colliders.Clear();
+	this->Sprites.Clear();
+	this->Scores.Clear();
+	this->FixedBodies.Clear();
+	this->freeIds.clear();
+	this->next = 0;
+}
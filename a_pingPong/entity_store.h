@@ -0,0 +1,132 @@
+#ifndef ENTITY_STORE_H
+#define ENTITY_STORE_H
+
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "fixed_point.h"
+#include "texture.h"
+
+
+// An entity is just an id; what it is follows from the components it has
+typedef unsigned int Entity;
+const Entity NO_ENTITY = ~0u;
+
+// Components
+// ----------
+// placement of an entity's axis-aligned rectangle (top-left corner)
+struct Transform {
+	glm::vec2 Position, Size;
+	float     Rotation;
+};
+// entities that move on their own
+struct Kinematic {
+	glm::vec2    Velocity;
+	bool         Stuck; // held by a paddle until served
+	unsigned int Hits;  // paddle hits since the serve (the level's speed curve)
+};
+// shape used for collision tests: a circle of Radius in the entity's rectangle, or the rectangle itself
+enum ColliderShape {
+	COLLIDER_BOX,
+	COLLIDER_CIRCLE
+};
+struct Collider {
+	ColliderShape Shape;
+	float         Radius;
+};
+struct Sprite {
+	Texture2D Texture;
+	glm::vec3 Color;
+};
+struct Score {
+	unsigned int Points;
+};
+// authoritative position and velocity of a moving entity in fixed-point mode;
+// Transform and Kinematic then hold copies for rendering and effects
+struct FixedBody {
+	FixedVec2 Position, Velocity;
+};
+
+
+// ComponentArray stores one component type as a sparse set: the components
+// are packed in Dense, with the entity owning each one at the same index in
+// Entities, so systems iterate contiguous memory; the sparse index maps an
+// entity to its slot. Removing moves the last component into the hole, so
+// the iteration order is the order components were added until one is removed.
+template <typename T>
+class ComponentArray
+{
+public:
+	std::vector<T>      Dense;
+	std::vector<Entity> Entities;
+	// adds (or replaces) the component of entity
+	T &Add(Entity entity, const T &component)
+	{
+		if (entity >= this->sparse.size())
+			this->sparse.resize(entity + 1, NO_ENTITY);
+		if (this->sparse[entity] != NO_ENTITY)
+			return this->Dense[this->sparse[entity]] = component;
+		this->sparse[entity] = static_cast<unsigned int>(this->Dense.size());
+		this->Dense.push_back(component);
+		this->Entities.push_back(entity);
+		return this->Dense.back();
+	}
+	void Remove(Entity entity)
+	{
+		if (!this->Has(entity))
+			return;
+		unsigned int slot = this->sparse[entity];
+		Entity last = this->Entities.back();
+		this->Dense[slot] = this->Dense.back();
+		this->Entities[slot] = last;
+		this->sparse[last] = slot;
+		this->sparse[entity] = NO_ENTITY;
+		this->Dense.pop_back();
+		this->Entities.pop_back();
+	}
+	bool Has(Entity entity) const { return entity < this->sparse.size() && this->sparse[entity] != NO_ENTITY; }
+	// the component of entity, which must have one
+	T       &Get(Entity entity) { return this->Dense[this->sparse[entity]]; }
+	const T &Get(Entity entity) const { return this->Dense[this->sparse[entity]]; }
+	// the component of entity, or nullptr
+	T       *Find(Entity entity) { return this->Has(entity) ? &this->Dense[this->sparse[entity]] : nullptr; }
+	unsigned int Size() const { return static_cast<unsigned int>(this->Dense.size()); }
+	void Clear()
+	{
+		this->Dense.clear();
+		this->Entities.clear();
+		this->sparse.clear();
+	}
+private:
+	std::vector<unsigned int> sparse;
+};
+
+
+// EntityStore holds every entity of a match as dense component arrays.
+// Systems (see game_systems.h) work on the arrays they need, so adding a
+// kind of object means adding an entity with the right components rather
+// than a new class.
+class EntityStore
+{
+public:
+	ComponentArray<Transform> Transforms;
+	ComponentArray<Kinematic> Kinematics;
+	ComponentArray<Collider>  Colliders;
+	ComponentArray<Sprite>    Sprites;
+	ComponentArray<Score>     Scores;
+	ComponentArray<FixedBody> FixedBodies;
+	// constructor
+	EntityStore() : next(0) { }
+	// returns a new entity without components
+	Entity Create();
+	// removes entity and all its components; its id is reused
+	void   Destroy(Entity entity);
+	// removes every entity
+	void   Clear();
+private:
+	Entity              next;
+	std::vector<Entity> freeIds;
+};
+
+#endif
@@ -0,0 +1,108 @@
+#ifndef FIXED_POINT_H
+#define FIXED_POINT_H
+
+#include <cmath>
+#include <cstdint>
+
+#include <glm/glm.hpp>
+
+
+// Fixed is a Q16.16 fixed-point number: a 32-bit integer counting 1/65536ths,
+// enough for positions and velocities anywhere in the arena. Everything is
+// integer arithmetic (products and quotients through 64 bits, truncated), so
+// a result is the same bit for bit on every compiler, optimization level and
+// instruction set, which floats do not guarantee once a compiler contracts
+// or vectorizes them. Conversions from float round to the nearest 1/65536th.
+struct Fixed {
+	int32_t Raw;
+
+	static Fixed FromRaw(int32_t raw) { Fixed value; value.Raw = raw; return value; }
+	static Fixed FromInt(int value) { return FromRaw(value * 65536); }
+	static Fixed FromFloat(float value) { return FromRaw(static_cast<int32_t>(std::lround(static_cast<double>(value) * 65536.0))); }
+	float ToFloat() const { return this->Raw / 65536.0f; }
+
+	Fixed operator-() const { return FromRaw(-this->Raw); }
+	Fixed operator+(Fixed other) const { return FromRaw(this->Raw + other.Raw); }
+	Fixed operator-(Fixed other) const { return FromRaw(this->Raw - other.Raw); }
+	Fixed operator*(Fixed other) const { return FromRaw(static_cast<int32_t>(static_cast<int64_t>(this->Raw) * other.Raw / 65536)); }
+	Fixed operator/(Fixed other) const { return FromRaw(static_cast<int32_t>(static_cast<int64_t>(this->Raw) * 65536 / other.Raw)); }
+	Fixed &operator+=(Fixed other) { this->Raw += other.Raw; return *this; }
+	Fixed &operator-=(Fixed other) { this->Raw -= other.Raw; return *this; }
+	bool operator==(Fixed other) const { return this->Raw == other.Raw; }
+	bool operator!=(Fixed other) const { return this->Raw != other.Raw; }
+	bool operator<(Fixed other) const { return this->Raw < other.Raw; }
+	bool operator>(Fixed other) const { return this->Raw > other.Raw; }
+	bool operator<=(Fixed other) const { return this->Raw <= other.Raw; }
+	bool operator>=(Fixed other) const { return this->Raw >= other.Raw; }
+};
+
+inline Fixed Abs(Fixed value) { return value.Raw < 0 ? -value : value; }
+inline Fixed Min(Fixed a, Fixed b) { return a < b ? a : b; }
+inline Fixed Max(Fixed a, Fixed b) { return a > b ? a : b; }
+
+// integer square root: the largest r with r * r <= value
+inline uint64_t SqrtInt(uint64_t value)
+{
+	uint64_t result = 0, bit = 1ull << 62;
+	while (bit > value)
+		bit >>= 2;
+	for (; bit; bit >>= 2)
+	{
+		if (value >= result + bit)
+		{
+			value -= result + bit;
+			result = (result >> 1) + bit;
+		}
+		else
+			result >>= 1;
+	}
+	return result;
+}
+
+// sine and cosine of small angles (|angle| up to about 1 radian), from their Taylor series
+inline Fixed Sin(Fixed angle)
+{
+	Fixed square = angle * angle;
+	return angle * (Fixed::FromInt(1) - square / Fixed::FromInt(6) * (Fixed::FromInt(1) - square / Fixed::FromInt(20)));
+}
+inline Fixed Cos(Fixed angle)
+{
+	Fixed square = angle * angle;
+	return Fixed::FromInt(1) - square / Fixed::FromInt(2) * (Fixed::FromInt(1) - square / Fixed::FromInt(12) * (Fixed::FromInt(1) - square / Fixed::FromInt(30)));
+}
+
+
+// Two-component vector of Fixed, the counterpart of glm::vec2
+struct FixedVec2 {
+	Fixed x, y;
+
+	static FixedVec2 FromFloat(glm::vec2 value) { FixedVec2 result = { Fixed::FromFloat(value.x), Fixed::FromFloat(value.y) }; return result; }
+	glm::vec2 ToFloat() const { return glm::vec2(this->x.ToFloat(), this->y.ToFloat()); }
+
+	FixedVec2 operator-() const { FixedVec2 result = { -this->x, -this->y }; return result; }
+	FixedVec2 operator+(FixedVec2 other) const { FixedVec2 result = { this->x + other.x, this->y + other.y }; return result; }
+	FixedVec2 operator-(FixedVec2 other) const { FixedVec2 result = { this->x - other.x, this->y - other.y }; return result; }
+	FixedVec2 operator*(Fixed scale) const { FixedVec2 result = { this->x * scale, this->y * scale }; return result; }
+	FixedVec2 operator/(Fixed scale) const { FixedVec2 result = { this->x / scale, this->y / scale }; return result; }
+	FixedVec2 &operator+=(FixedVec2 other) { this->x += other.x; this->y += other.y; return *this; }
+	FixedVec2 &operator-=(FixedVec2 other) { this->x -= other.x; this->y -= other.y; return *this; }
+};
+
+inline Fixed Dot(FixedVec2 a, FixedVec2 b)
+{
+	return Fixed::FromRaw(static_cast<int32_t>((static_cast<int64_t>(a.x.Raw) * b.x.Raw + static_cast<int64_t>(a.y.Raw) * b.y.Raw) / 65536));
+}
+// the squares are summed in 64 bits, so lengths up to the largest Fixed do not overflow
+inline Fixed Length(FixedVec2 v)
+{
+	uint64_t squares = static_cast<uint64_t>(static_cast<int64_t>(v.x.Raw) * v.x.Raw) + static_cast<uint64_t>(static_cast<int64_t>(v.y.Raw) * v.y.Raw);
+	return Fixed::FromRaw(static_cast<int32_t>(SqrtInt(squares)));
+}
+// a zero vector has no direction and stays zero (the integer divide would trap)
+inline FixedVec2 Normalize(FixedVec2 v)
+{
+	Fixed length = Length(v);
+	return length.Raw == 0 ? v : v / length;
+}
+
+#endif
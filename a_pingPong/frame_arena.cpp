@@ -0,0 +1,61 @@
+#include "frame_arena.h"
+
+#include <cstdlib>
+
+// Instantiate static variables
+unsigned char      *FrameArena::memory = nullptr;
+size_t              FrameArena::capacity = 0;
+size_t              FrameArena::offset = 0;
+size_t              FrameArena::overflowBytes = 0;
+size_t              FrameArena::highWater = 0;
+std::vector<void*>  FrameArena::overflow;
+
+void *FrameArena::Allocate(size_t size, size_t alignment)
+{
+	if (!memory)
+	{
+		capacity = INITIAL_CAPACITY;
+		memory = static_cast<unsigned char*>(std::malloc(capacity));
+	}
+	size_t start = (offset + alignment - 1) & ~(alignment - 1);
+	if (start + size <= capacity)
+	{
+		offset = start + size;
+		return memory + start;
+	}
+	// out of space this frame: take it from the heap, Reset grows the arena
+	overflowBytes += size + alignment;
+	void *block = std::malloc(size + alignment);
+	overflow.push_back(block);
+	size_t address = reinterpret_cast<size_t>(block);
+	return reinterpret_cast<void*>((address + alignment - 1) & ~(alignment - 1));
+}
+
+void FrameArena::Reset()
+{
+	size_t used = offset + overflowBytes;
+	if (used > highWater)
+		highWater = used;
+	if (!overflow.empty())
+	{
+		for (void *block : overflow)
+			std::free(block);
+		overflow.clear();
+		// grow with some headroom so a slowly rising peak does not regrow every frame
+		std::free(memory);
+		capacity = highWater + highWater / 2;
+		memory = static_cast<unsigned char*>(std::malloc(capacity));
+	}
+	offset = 0;
+	overflowBytes = 0;
+}
+
+size_t FrameArena::Used()
+{
+	return offset + overflowBytes;
+}
+
+size_t FrameArena::HighWater()
+{
+	return highWater;
+}
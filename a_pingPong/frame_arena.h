@@ -0,0 +1,36 @@
+#ifndef FRAME_ARENA_H
+#define FRAME_ARENA_H
+
+#include <cstddef>
+#include <vector>
+
+
+// A static linear (bump) allocator for data that only lives for one frame,
+// such as text quads and particle instances built right before they are
+// uploaded. Allocating is a pointer increment, nothing is freed
+// individually; Reset releases everything at the start of the next frame.
+// When a frame needs more than the capacity the excess comes from the heap
+// and the arena grows to the high-water mark on the next Reset, so memory
+// use settles after the first frames. Render thread only.
+class FrameArena
+{
+public:
+	// capacity reserved on first use
+	static const size_t INITIAL_CAPACITY = 256 * 1024;
+	// returns uninitialized memory valid until the next Reset
+	static void  *Allocate(size_t size, size_t alignment = 16);
+	template <typename T>
+	static T     *Allocate(size_t count) { return static_cast<T*>(Allocate(count * sizeof(T), alignof(T))); }
+	// releases all allocations; call once per frame
+	static void   Reset();
+	// bytes handed out since the last Reset, and the most any frame used
+	static size_t Used();
+	static size_t HighWater();
+private:
+	static unsigned char       *memory;
+	static size_t               capacity, offset, overflowBytes, highWater;
+	static std::vector<void*>   overflow;
+	FrameArena() { }
+};
+
+#endif
@@ -0,0 +1,318 @@
+#include "frame_capture.h"
+
+#include <glad/glad.h>
+
+#include <cctype>
+#include <cstring>
+#include <iostream>
+
+// true if pattern is safe to format the frame number (an unsigned int) with: exactly one
+// conversion, %d, %i or %u with optional flags, width and precision, and otherwise only %%
+static bool isFrameNumberPattern(const std::string &pattern)
+{
+	unsigned int conversions = 0;
+	for (size_t i = 0; i < pattern.size(); ++i)
+	{
+		if (pattern[i] != '%')
+			continue;
+		if (++i < pattern.size() && pattern[i] == '%')
+			continue;
+		while (i < pattern.size() && strchr("0-+ ", pattern[i]))
+			++i;
+		while (i < pattern.size() && (isdigit(static_cast<unsigned char>(pattern[i])) || pattern[i] == '.'))
+			++i;
+		if (i == pattern.size() || !strchr("diu", pattern[i]))
+			return false;
+		++conversions;
+	}
+	return conversions == 1;
+}
+
+FrameCapture::FrameCapture()
+	: FramesWritten(0), issued(0), collected(0), width(0), height(0), fps(60), png(false), running(false), video(nullptr)
+{
+	for (unsigned int i = 0; i < PBO_COUNT; ++i)
+	{
+		this->pbos[i] = 0;
+		this->fences[i] = nullptr;
+	}
+}
+
+FrameCapture::~FrameCapture()
+{
+	this->Close();
+}
+
+bool FrameCapture::Open(const std::string &path, unsigned int width, unsigned int height, unsigned int fps)
+{
+	this->path = path;
+	this->width = width;
+	this->height = height;
+	this->fps = fps;
+	this->png = path.size() >= 4 && path.compare(path.size() - 4, 4, ".png") == 0;
+	// the path becomes a printf format, so it must not convert anything but the frame number
+	if (this->png && !isFrameNumberPattern(path))
+	{
+		std::cout << "ERROR::CAPTURE: PNG sequences need one frame number pattern such as frame_%05d.png" << std::endl;
+		return false;
+	}
+	if (!this->png)
+	{
+		this->video = fopen(path.c_str(), "wb");
+		if (!this->video)
+		{
+			std::cout << "ERROR::CAPTURE: Failed to open " << path << std::endl;
+			return false;
+		}
+		fprintf(this->video, "YUV4MPEG2 W%u H%u F%u:1 Ip A1:1 C420jpeg\n", width, height, fps);
+	}
+	// pixel buffers the frames are read back into
+	GLsizeiptr size = static_cast<GLsizeiptr>(width) * height * 4;
+	glGenBuffers(PBO_COUNT, this->pbos);
+	for (unsigned int i = 0; i < PBO_COUNT; ++i)
+	{
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, this->pbos[i]);
+		glBufferData(GL_PIXEL_PACK_BUFFER, size, nullptr, GL_STREAM_READ);
+	}
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+	this->issued = this->collected = this->FramesWritten = 0;
+	this->running = true;
+	this->writer = std::thread(&FrameCapture::writeLoop, this);
+	return true;
+}
+
+void FrameCapture::Capture()
+{
+	if (!this->running)
+		return;
+	// all buffers in flight: the oldest one has had PBO_COUNT - 1 frames to finish
+	if (this->issued - this->collected == PBO_COUNT)
+		this->collect();
+	unsigned int slot = this->issued % PBO_COUNT;
+	glPixelStorei(GL_PACK_ALIGNMENT, 1);
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, this->pbos[slot]);
+	glReadPixels(0, 0, this->width, this->height, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+	this->fences[slot] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	++this->issued;
+}
+
+void FrameCapture::Close()
+{
+	if (!this->running)
+		return;
+	while (this->collected != this->issued)
+		this->collect();
+	{
+		std::lock_guard<std::mutex> guard(this->lock);
+		this->running = false;
+	}
+	this->ready.notify_one();
+	this->writer.join();
+	glDeleteBuffers(PBO_COUNT, this->pbos);
+	if (this->video)
+	{
+		fclose(this->video);
+		this->video = nullptr;
+	}
+	for (std::vector<unsigned char> *frame : this->pool)
+		delete frame;
+	this->pool.clear();
+}
+
+void FrameCapture::collect()
+{
+	unsigned int slot = this->collected % PBO_COUNT;
+	GLsync fence = static_cast<GLsync>(this->fences[slot]);
+	glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, GL_TIMEOUT_IGNORED);
+	glDeleteSync(fence);
+	this->fences[slot] = nullptr;
+	// take a free frame buffer, waiting for the writer if it has fallen too far behind
+	std::vector<unsigned char> *frame;
+	{
+		std::unique_lock<std::mutex> guard(this->lock);
+		this->space.wait(guard, [this] { return this->queue.size() < MAX_QUEUED; });
+		if (this->pool.empty())
+			frame = new std::vector<unsigned char>();
+		else
+		{
+			frame = this->pool.back();
+			this->pool.pop_back();
+		}
+	}
+	size_t size = static_cast<size_t>(this->width) * this->height * 4;
+	frame->resize(size);
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, this->pbos[slot]);
+	void *pixels = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, size, GL_MAP_READ_BIT);
+	if (pixels)
+	{
+		memcpy(&(*frame)[0], pixels, size);
+		glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+	}
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+	++this->collected;
+	{
+		std::lock_guard<std::mutex> guard(this->lock);
+		this->queue.push_back(frame);
+	}
+	this->ready.notify_one();
+}
+
+void FrameCapture::writeLoop()
+{
+	for (;;)
+	{
+		std::vector<unsigned char> *frame;
+		{
+			std::unique_lock<std::mutex> guard(this->lock);
+			this->ready.wait(guard, [this] { return !this->queue.empty() || !this->running; });
+			if (this->queue.empty())
+				return;
+			frame = this->queue.front();
+			this->queue.pop_front();
+		}
+		this->space.notify_one();
+		if (this->png)
+			this->writePNG(*frame, this->FramesWritten);
+		else
+			this->writeY4M(*frame);
+		std::lock_guard<std::mutex> guard(this->lock);
+		++this->FramesWritten;
+		this->pool.push_back(frame);
+	}
+}
+
+void FrameCapture::writeY4M(const std::vector<unsigned char> &rgba)
+{
+	// full range BT.601 (C420jpeg); chroma is the average of each 2x2 block.
+	// OpenGL rows are bottom-up, video rows top-down
+	unsigned int w = this->width, h = this->height;
+	unsigned int cw = (w + 1) / 2, ch = (h + 1) / 2;
+	this->yuv.resize(w * h + 2 * cw * ch);
+	unsigned char *Y = &this->yuv[0], *U = Y + w * h, *V = U + cw * ch;
+	for (unsigned int y = 0; y < h; ++y)
+	{
+		const unsigned char *row = &rgba[(h - 1 - y) * w * 4];
+		for (unsigned int x = 0; x < w; ++x)
+		{
+			const unsigned char *p = row + x * 4;
+			Y[y * w + x] = static_cast<unsigned char>((77 * p[0] + 150 * p[1] + 29 * p[2] + 128) >> 8);
+		}
+	}
+	for (unsigned int y = 0; y < ch; ++y)
+	{
+		for (unsigned int x = 0; x < cw; ++x)
+		{
+			int r = 0, g = 0, b = 0;
+			for (unsigned int dy = 0; dy < 2; ++dy)
+			{
+				unsigned int sy = y * 2 + dy < h ? y * 2 + dy : h - 1;
+				for (unsigned int dx = 0; dx < 2; ++dx)
+				{
+					unsigned int sx = x * 2 + dx < w ? x * 2 + dx : w - 1;
+					const unsigned char *p = &rgba[((h - 1 - sy) * w + sx) * 4];
+					r += p[0]; g += p[1]; b += p[2];
+				}
+			}
+			// sums of four samples: shift by 2 more than the per-pixel formula
+			int u = 128 + ((-43 * r - 85 * g + 128 * b + 512) >> 10);
+			int v = 128 + ((128 * r - 107 * g - 21 * b + 512) >> 10);
+			U[y * cw + x] = static_cast<unsigned char>(u > 255 ? 255 : u);
+			V[y * cw + x] = static_cast<unsigned char>(v > 255 ? 255 : v);
+		}
+	}
+	fputs("FRAME\n", this->video);
+	fwrite(&this->yuv[0], 1, this->yuv.size(), this->video);
+}
+
+// PNG helpers: the image data is stored uncompressed (deflate "stored"
+// blocks), trading file size for not needing zlib; recompress with any
+// PNG optimizer or feed the sequence straight to a video encoder
+static unsigned int crc32(const unsigned char *data, size_t length, unsigned int crc = 0)
+{
+	static unsigned int table[256];
+	if (!table[1])
+	{
+		for (unsigned int n = 0; n < 256; ++n)
+		{
+			unsigned int c = n;
+			for (int k = 0; k < 8; ++k)
+				c = c & 1 ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+			table[n] = c;
+		}
+	}
+	crc = ~crc;
+	for (size_t i = 0; i < length; ++i)
+		crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+	return ~crc;
+}
+
+static void putBigEndian(std::vector<unsigned char> &out, unsigned int value)
+{
+	out.push_back(value >> 24); out.push_back(value >> 16); out.push_back(value >> 8); out.push_back(value);
+}
+
+static void putChunk(std::vector<unsigned char> &out, const char *type, const std::vector<unsigned char> &data)
+{
+	putBigEndian(out, static_cast<unsigned int>(data.size()));
+	size_t start = out.size();
+	out.insert(out.end(), type, type + 4);
+	out.insert(out.end(), data.begin(), data.end());
+	putBigEndian(out, crc32(&out[start], out.size() - start));
+}
+
+void FrameCapture::writePNG(const std::vector<unsigned char> &rgba, unsigned int index)
+{
+	unsigned int w = this->width, h = this->height;
+	// scanlines: filter byte 0 followed by RGB, top row first
+	std::vector<unsigned char> raw;
+	raw.reserve(h * (w * 3 + 1));
+	for (unsigned int y = 0; y < h; ++y)
+	{
+		const unsigned char *row = &rgba[(h - 1 - y) * w * 4];
+		raw.push_back(0);
+		for (unsigned int x = 0; x < w; ++x)
+			raw.insert(raw.end(), row + x * 4, row + x * 4 + 3);
+	}
+	// zlib stream of stored blocks
+	std::vector<unsigned char> idat;
+	idat.reserve(raw.size() + raw.size() / 65535 * 5 + 16);
+	idat.push_back(0x78); idat.push_back(0x01);
+	unsigned int a = 1, b = 0;
+	for (size_t offset = 0; offset < raw.size();)
+	{
+		unsigned int length = static_cast<unsigned int>(raw.size() - offset < 65535 ? raw.size() - offset : 65535);
+		idat.push_back(offset + length == raw.size() ? 1 : 0);
+		idat.push_back(length & 0xFF); idat.push_back(length >> 8);
+		idat.push_back(~length & 0xFF); idat.push_back((~length >> 8) & 0xFF);
+		idat.insert(idat.end(), raw.begin() + offset, raw.begin() + offset + length);
+		for (unsigned int i = 0; i < length; ++i)
+		{
+			a = (a + raw[offset + i]) % 65521;
+			b = (b + a) % 65521;
+		}
+		offset += length;
+	}
+	putBigEndian(idat, (b << 16) | a);
+
+	std::vector<unsigned char> header;
+	putBigEndian(header, w);
+	putBigEndian(header, h);
+	const unsigned char format[] = { 8, 2, 0, 0, 0 }; // 8 bit RGB, no interlacing
+	header.insert(header.end(), format, format + 5);
+	std::vector<unsigned char> file = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+	putChunk(file, "IHDR", header);
+	putChunk(file, "IDAT", idat);
+	putChunk(file, "IEND", std::vector<unsigned char>());
+
+	char name[1024];
+	snprintf(name, sizeof(name), this->path.c_str(), index);
+	FILE *out = fopen(name, "wb");
+	if (!out)
+	{
+		std::cout << "ERROR::CAPTURE: Failed to open " << name << std::endl;
+		return;
+	}
+	fwrite(&file[0], 1, file.size(), out);
+	fclose(out);
+}
@@ -0,0 +1,59 @@
+#ifndef FRAME_CAPTURE_H
+#define FRAME_CAPTURE_H
+
+#include <condition_variable>
+#include <cstdio>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+
+// FrameCapture records the rendered frames to a video without stalling the
+// renderer: glReadPixels goes into a ring of pixel buffer objects and each
+// buffer is only mapped a couple of frames later, when the GPU has finished
+// the copy. Encoding and disk writes run on a writer thread. Output is a
+// Y4M video (*.y4m, 4:2:0) or a numbered PNG sequence (a printf pattern such
+// as frames/%05d.png).
+class FrameCapture
+{
+public:
+	// constructor/destructor
+	FrameCapture();
+	~FrameCapture();
+	// creates the pixel buffers (needs a current GL context) and starts the writer thread
+	bool Open(const std::string &path, unsigned int width, unsigned int height, unsigned int fps);
+	// queues a readback of the current read framebuffer and hands finished frames to the writer
+	void Capture();
+	// flushes the outstanding readbacks, waits for the writer and releases the buffers
+	void Close();
+	// frames handed to the writer so far
+	unsigned int FramesWritten;
+private:
+	static const unsigned int PBO_COUNT = 3;
+	// frames the writer may lag behind before Capture blocks
+	static const unsigned int MAX_QUEUED = 8;
+	// readback state
+	unsigned int pbos[PBO_COUNT];
+	void        *fences[PBO_COUNT];
+	unsigned int issued, collected;
+	unsigned int width, height, fps;
+	// writer state
+	std::string                              path;
+	bool                                     png, running;
+	FILE                                    *video;
+	std::thread                              writer;
+	std::mutex                               lock;
+	std::condition_variable                  ready, space;
+	std::deque<std::vector<unsigned char>*>  queue, pool;
+	std::vector<unsigned char>               yuv;
+	// maps the oldest outstanding pixel buffer and queues its frame
+	void collect();
+	// writer thread main loop
+	void writeLoop();
+	void writeY4M(const std::vector<unsigned char> &rgba);
+	void writePNG(const std::vector<unsigned char> &rgba, unsigned int index);
+};
+
+#endif
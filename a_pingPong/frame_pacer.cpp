@@ -0,0 +1,98 @@
+#include "frame_pacer.h"
+
+#include <algorithm>
+#include <chrono>
+#include <thread>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#ifndef CREATE_WAITABLE_TIMER_HIGH_RESOLUTION
+#define CREATE_WAITABLE_TIMER_HIGH_RESOLUTION 0x00000002
+#endif
+#endif
+
+// the last part of a wait is spun, since even high-resolution sleeps can wake this late
+const double SPIN_SECONDS = 0.0005;
+
+FramePacer::FramePacer()
+	: Mode(PACING_OFF), RefreshRate(60.0), FpsCap(60), SafetyMargin(0.002),
+	  frameStart(0.0), lastPresent(0.0), nextFrame(0.0), work(), workCount(0)
+{
+}
+
+double FramePacer::Now()
+{
+	return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void FramePacer::sleepUntil(double time)
+{
+#ifdef _WIN32
+	// Sleep() only wakes on the 15.6 ms system tick; high-resolution timers exist since Windows 10 1803
+	static HANDLE timer = CreateWaitableTimerExW(nullptr, nullptr, CREATE_WAITABLE_TIMER_HIGH_RESOLUTION, TIMER_ALL_ACCESS);
+#endif
+	for (double remaining = time - Now(); remaining > 0.0; remaining = time - Now())
+	{
+		if (remaining <= SPIN_SECONDS)
+		{
+			std::this_thread::yield();
+			continue;
+		}
+#ifdef _WIN32
+		if (timer)
+		{
+			// relative due time in 100 ns units
+			LARGE_INTEGER due;
+			due.QuadPart = -static_cast<LONGLONG>((remaining - SPIN_SECONDS) * 1.0e7);
+			SetWaitableTimer(timer, &due, 0, nullptr, nullptr, FALSE);
+			WaitForSingleObject(timer, INFINITE);
+			continue;
+		}
+#endif
+		std::this_thread::sleep_for(std::chrono::duration<double>(remaining - SPIN_SECONDS));
+	}
+}
+
+double FramePacer::WorkEstimate() const
+{
+	double largest = 0.0;
+	for (unsigned int i = 0; i < std::min(this->workCount, WORK_WINDOW); ++i)
+		largest = std::max(largest, this->work[i]);
+	return largest;
+}
+
+void FramePacer::BeginFrame()
+{
+	double now = Now();
+	if (this->Mode == PACING_CAP && this->FpsCap > 0)
+	{
+		double period = 1.0 / this->FpsCap;
+		sleepUntil(this->nextFrame);
+		// after a stall, start counting again instead of rushing frames out to catch up
+		this->nextFrame = std::max(this->nextFrame + period, Now());
+	}
+	else if (this->Mode == PACING_LOW_LATENCY && this->lastPresent > 0.0 && this->RefreshRate > 0.0)
+	{
+		// the first vblank the frame can still make, minus the frame's cost; one it cannot make
+		// is presented at the same vblank as a frame started later, with fresher input
+		double period = 1.0 / this->RefreshRate;
+		double lead = this->WorkEstimate() + this->SafetyMargin;
+		double deadline = this->lastPresent + period;
+		while (deadline - lead < now)
+			deadline += period;
+		sleepUntil(deadline - lead);
+	}
+	this->frameStart = Now();
+}
+
+void FramePacer::EndFrame()
+{
+	this->work[this->workCount++ % WORK_WINDOW] = Now() - this->frameStart;
+}
+
+void FramePacer::Presented()
+{
+	this->lastPresent = Now();
+}
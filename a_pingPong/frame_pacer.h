@@ -0,0 +1,49 @@
+#ifndef FRAME_PACER_H
+#define FRAME_PACER_H
+
+// How FramePacer schedules frames
+enum PacingMode {
+	PACING_OFF,         // start every frame as soon as the previous swap returns
+	PACING_CAP,         // at most FpsCap frames per second, without vsync
+	PACING_LOW_LATENCY  // start each frame just in time for the next vblank
+};
+
+
+// FramePacer decides when the main loop starts a frame, that is when it
+// samples input and runs the simulation. In low-latency mode it predicts
+// the next vblank from when the previous swap returned and the refresh
+// period, and waits until the frame's measured cost (the largest of the
+// recent frames, plus SafetyMargin) before it; the input then is as fresh
+// as it can be when the frame is shown. The cap mode just waits for the
+// next multiple of 1/FpsCap. Waits sleep on a high-resolution timer and
+// spin only for the last fraction of a millisecond.
+class FramePacer
+{
+public:
+	// configuration
+	PacingMode   Mode;
+	double       RefreshRate;   // Hz of the display, for low-latency mode
+	unsigned int FpsCap;        // frames per second in cap mode
+	double       SafetyMargin;  // seconds kept free before the vblank for the driver and sleep jitter
+	// constructor
+	FramePacer();
+	// blocks until the next frame should start
+	void BeginFrame();
+	// call right before the buffer swap: the frame's CPU work is done
+	void EndFrame();
+	// call once the buffer swap returned; in low-latency mode after glFinish, so that is at the vblank
+	void Presented();
+	// predicted CPU cost of the next frame, in seconds
+	double WorkEstimate() const;
+	// seconds on the pacer's monotonic clock
+	static double Now();
+private:
+	static const unsigned int WORK_WINDOW = 32;
+	double       frameStart, lastPresent, nextFrame;
+	double       work[WORK_WINDOW];
+	unsigned int workCount;
+	// sleeps, then spins, until time
+	static void sleepUntil(double time);
+};
+
+#endif
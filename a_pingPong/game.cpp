@@ -1,43 +1,117 @@
 #include <algorithm>
+#include <cstdio>
+#include <cmath>
+#include <cstdlib>
 #include <iostream>
-#include <sstream>
-
-#include <irrKlang/irrKlang.h>
-using namespace irrklang;
-
 
 #include "game.h"
+#include "allocation_tracker.h"
+#include "audio_engine.h"
+#include "frame_arena.h"
+#include "gpu_particle_generator.h"
+#include "game_systems.h"
 #include "sprite_renderer.h"
 #include "resource_manager.h"
-#include "ball_object.h"
 #include "particle_generator.h"
+#include "profiler.h"
+#include "quality_governor.h"
+#include "resolution_scaler.h"
 #include "text_renderer.h"
+#include "uniform_grid.h"
 
 // Game-related State data
 SpriteRenderer     *Renderer;
-GameObject         *Player1;
-GameObject         *Player2;
-BallObject         *Ball;
+// the lead ball carries the particle trail and follows the serving paddle
+Entity              Ball;
+Entity              Player1;
+Entity              Player2;
+UniformGrid        *Broadphase;
 ParticleGenerator  *Particles;
+GpuParticleGenerator *GpuParticles;
 TextRenderer       *Text;
 TextRenderer       *Text_;
-ISoundEngine       *SoundEngine = createIrrKlangDevice();
+// renders the scene at a reduced resolution (ResolutionScale, DynamicResolution)
+ResolutionScaler   *Scaler;
+// steps the trail and the resolution to keep frames within QualityBudget
+QualityGovernor    *Quality;
+AudioEngine        *Audio;
+SoundHandle         BleepSound;
+SoundHandle         PlogSound;
+// looked up once in Init so rendering does no resource lookups
+Texture2D           BackgroundTexture;
+Texture2D           BallTexture;
+Texture2D           BlockTexture;
+
+// particles the trail spawns per tick: 2 for every 500, scaled by the quality tier but to at
+// most quality (the GPU pool has a fixed size, so more spawns would only shorten the trail)
+static unsigned int trailSpawns(unsigned int particles, float maxQuality)
+{
+	float quality = Quality ? std::min(Quality->Current().Particles, maxQuality) : 1.0f;
+	if (quality <= 0.0f)
+		return 0;
+	return std::max(2u, static_cast<unsigned int>(particles * quality) / 250);
+}
+
+// makes the particle pool and the scene resolution those of the governor's current tier
+static void applyQualityTier(Game &game)
+{
+	const QualityTier &tier = Quality->Current();
+	game.QualityTier = Quality->Tier;
+	if (Particles)
+		Particles->SetLimit(static_cast<unsigned int>(game.ParticleCount * tier.Particles));
+	Scaler->Scale = tier.Resolution;
+	game.ResolutionScale = tier.Resolution;
+}
+
+// draws the background, particles, obstacles, ball and players (not the text)
+static void drawScene(Game &game)
+{
+	// draw background
+	{
+		PROFILE_GPU_SCOPE("Background");
+		Renderer->DrawSprite(BackgroundTexture,
+			glm::vec2(0.0f, 0.0f), glm::vec2(game.Width, game.Height), 0.0f
+		);
+	}
+
+	// draw particles
+	{
+		PROFILE_GPU_SCOPE("DrawParticles");
+		if (GpuParticles)
+			GpuParticles->Draw();
+		else
+			Particles->Draw();
+	}
+
+	// draw obstacles, ball and players
+	{
+		PROFILE_GPU_SCOPE("DrawSprites");
+		for (const Transform &obstacle : game.Levels[game.Level].Obstacles)
+			Renderer->DrawSprite(BlockTexture, obstacle.Position, obstacle.Size);
+		SpriteSystem(game.Entities, *Renderer);
+	}
+}
 
 Game::Game(unsigned int width, unsigned int height)
-	: State(GAME_MENU), Keys(), Width(width), Height(height), isPlayer1(true)
+	: State(GAME_MENU), isPlayer1(true), Player1Win(false), KeysProcessed(), Keys(), BallCount(1), Width(width), Height(height), AudioEnabled(true), ManualAudio(false), ParticleCount(500), GpuParticleCount(0), FixedPoint(false), ResolutionScale(1.0f), DynamicResolution(false), QualityBudget(0.0f), QualityTier(0)
 {
+#ifdef PINGPONG_PROFILE
+	this->ShowProfiler = false;
+#endif
 
 }
 
 Game::~Game()
 {
 	delete Renderer;
-	delete Player1;
-	delete Player2;
-	delete Ball;
+	delete Broadphase;
 	delete Particles;
+	delete GpuParticles;
 	delete Text;
 	delete Text_;
+	delete Scaler;
+	delete Quality;
+	delete Audio;
 }
 
 void Game::Init()
@@ -53,144 +127,265 @@ void Game::Init()
 	ResourceManager::GetShader("particle").Use().SetInteger("sprite", 0);
 	ResourceManager::GetShader("particle").SetMatrix4("projection", projection);
 	// load textures
-	ResourceManager::LoadTexture("textures/background.jpg", false, "background");
-	ResourceManager::LoadTexture("textures/ball.png", true, "ball");
-	ResourceManager::LoadTexture("textures/paddle1.png", true, "paddle1");
-	ResourceManager::LoadTexture("textures/paddle2.png", true, "paddle2");
-	ResourceManager::LoadTexture("textures/particle.png", true, "particle");
+	const TextureFile textures[] = {
+		{ "textures/background.jpg", false, "background" },
+		{ "textures/ball.png", true, "ball" },
+		{ "textures/block.png", true, "block" },
+		{ "textures/paddle1.png", true, "paddle1" },
+		{ "textures/paddle2.png", true, "paddle2" },
+		{ "textures/particle.png", true, "particle" }
+	};
+	ResourceManager::LoadTextures(textures, sizeof(textures) / sizeof(textures[0]));
+	BackgroundTexture = ResourceManager::GetTexture("background");
 	// set render-specific controls
 	Renderer = new SpriteRenderer(ResourceManager::GetShader("sprite"));
-	Particles = new ParticleGenerator(
-		ResourceManager::GetShader("particle"),
-		ResourceManager::GetTexture("particle"),
-		500
-	);
+	if (this->GpuParticleCount > 0)
+	{
+		ResourceManager::LoadTransformFeedbackShader("shaders/particle/particle_update.vs",
+			GpuParticleGenerator::VARYINGS, 4, "particle_update");
+		ResourceManager::LoadShader("shaders/particle/particle_gpu.vs", "shaders/particle/particle.fs", nullptr, "particle_gpu");
+		ResourceManager::GetShader("particle_gpu").Use().SetInteger("sprite", 0);
+		ResourceManager::GetShader("particle_gpu").SetMatrix4("projection", projection);
+		GpuParticles = new GpuParticleGenerator(
+			ResourceManager::GetShader("particle_update"),
+			ResourceManager::GetShader("particle_gpu"),
+			ResourceManager::GetTexture("particle"),
+			this->GpuParticleCount
+		);
+	}
+	else
+		// with a quality governor, the pool is reserved for the highest tier up front
+		Particles = new ParticleGenerator(
+			ResourceManager::GetShader("particle"),
+			ResourceManager::GetTexture("particle"),
+			static_cast<unsigned int>(this->ParticleCount * (this->QualityBudget > 0.0f ? QualityGovernor::MaxParticles() : 1.0f)),
+			static_cast<unsigned int>(rand())
+		);
 	Text = new TextRenderer(this->Width, this->Height);
 	Text_ = new TextRenderer(this->Width, this->Height);
 	Text->Load("fonts/OCRAEXT.TTF", 20);
 	Text_->Load("fonts/ALLSTAR.TTF", 85);
+	if (this->ResolutionScale < 1.0f || this->DynamicResolution || this->QualityBudget > 0.0f)
+	{
+		ResourceManager::LoadShader("shaders/upscale/upscale.vs", "shaders/upscale/upscale.fs", nullptr, "upscale");
+		ResourceManager::GetShader("upscale").Use().SetInteger("scene", 0);
+		Scaler = new ResolutionScaler(ResourceManager::GetShader("upscale"));
+		Scaler->Scale = std::min(1.0f, std::max(Scaler->MinScale, this->ResolutionScale));
+	}
+	if (this->QualityBudget > 0.0f)
+	{
+		Quality = new QualityGovernor(this->QualityBudget);
+		applyQualityTier(*this);
+	}
 	// configure game objects
-	glm::vec2 player1Pos = glm::vec2(
-		this->Width - PLAYER_SIZE.x - 5.0f,
-		this->Height / 2.0f - PLAYER_SIZE.y / 2.0f
-	);
-	Player1 = new GameObject(player1Pos, PLAYER_SIZE, ResourceManager::GetTexture("paddle1"));
-	glm::vec2 player2Pos = glm::vec2(
-		0.0f + 5.0f,
-		this->Height / 2.0f - PLAYER_SIZE.y / 2.0f
-	);
-	Player2 = new GameObject(player2Pos, PLAYER_SIZE, ResourceManager::GetTexture("paddle2"));
+	this->InitSimulation();
+	// draw one scaled frame now: the first draws into the scaled framebuffer create it and
+	// have the driver set up for it, which would allocate on the frame the scale first drops
+	if (Scaler)
+	{
+		Scaler->Begin();
+		drawScene(*this);
+		if (Particles)
+			Particles->Prime();
+		Scaler->End();
+	}
 
-	glm::vec2 ball1Pos = player1Pos + glm::vec2(-BALL_RADIUS * 2.0f, PLAYER_SIZE.y / 2.0f - BALL_RADIUS);
-	glm::vec2 ball2Pos = player2Pos + glm::vec2(BALL_RADIUS * 2.0f, PLAYER_SIZE.y / 2.0f - BALL_RADIUS);
+	// audio: effects are decoded up front so triggering them never touches the disk
+	if (!this->AudioEnabled)
+		return;
+	Audio = new AudioEngine();
+	BleepSound = Audio->LoadSound("audio/bleep.mp3");
+	PlogSound = Audio->LoadSound("audio/plog.ogg");
+	// with ManualAudio the caller mixes through MixAudio, so neither the threads nor a device start
+	if (!this->ManualAudio && this->AudioCapture.empty())
+		Audio->Start(CreateDefaultAudioOutput());
+	else if (!this->ManualAudio)
+		Audio->Start(new WavFileAudioOutput(this->AudioCapture));
+	Audio->PlayMusic("audio/soundtrack.mp3", true);
+}
+
+bool Game::MixAudio(short *out, unsigned int frames)
+{
+	if (!Audio || !this->ManualAudio)
+		return false;
+	Audio->Mix(out, frames);
+	return true;
+}
+
+const AudioStats *Game::AudioStatistics() const
+{
+	return Audio ? &Audio->Stats() : nullptr;
+}
+
+void Game::InitSimulation()
+{
 	// load levels
-	GameLevel one; one.Load(ball1Pos, ball2Pos, BALL_RADIUS, 4.0f * INITIAL_BALL_VELOCITY);
-	GameLevel two; two.Load(ball1Pos, ball2Pos, BALL_RADIUS, 6.5f * INITIAL_BALL_VELOCITY);
-	GameLevel three; three.Load(ball1Pos, ball2Pos, BALL_RADIUS, 9.0f * INITIAL_BALL_VELOCITY);
-	GameLevel four; four.Load(ball1Pos, ball2Pos, BALL_RADIUS, 12.0f * INITIAL_BALL_VELOCITY);
-
-	this->Levels.push_back(one);
-	this->Levels.push_back(two);
-	this->Levels.push_back(three);
-	this->Levels.push_back(four);
+	// the pack compiled by the build if there is one, else the level files themselves
+	if (!GameLevel::LoadPack("levels/levels.bin", this->Levels) && !GameLevel::LoadList("levels/levels.txt", this->Levels))
+	{
+		std::cout << "ERROR::GAME: No levels found, playing the default arena" << std::endl;
+		GameLevel level;
+		level.Name = "Amateur";
+		level.BallRadius = BALL_RADIUS;
+		level.SpeedStart = level.SpeedMax = 4.0f;
+		level.PaddleSize = PLAYER_SIZE;
+		this->Levels.assign(1, level);
+	}
+	for (GameLevel &level : this->Levels)
+		level.BuildGrid(static_cast<float>(this->Width), static_cast<float>(this->Height));
 	this->Level = 0;
 
-	// set default selected player as player 1
-	Ball = this->Levels[this->Level].getBall1();
+	// configure game objects; sprites are drawn in the order they are added: ball, then paddles
+	const Collider paddleCollider = { COLLIDER_BOX, 0.0f };
+	const Score noScore = { 0 };
+	BallTexture = ResourceManager::GetTexture("ball");
+	BlockTexture = ResourceManager::GetTexture("block");
+	Ball = this->Entities.Create();
+	Player1 = this->Entities.Create();
+	Player2 = this->Entities.Create();
+	this->Entities.Sprites.Add(Ball, { BallTexture, glm::vec3(1.0f) });
+	this->Entities.Sprites.Add(Player1, { ResourceManager::GetTexture("paddle1"), glm::vec3(1.0f) });
+	this->Entities.Sprites.Add(Player2, { ResourceManager::GetTexture("paddle2"), glm::vec3(1.0f) });
+	this->Entities.Transforms.Add(Player1, { glm::vec2(0.0f), PLAYER_SIZE, 0.0f });
+	this->Entities.Transforms.Add(Player2, { glm::vec2(0.0f), PLAYER_SIZE, 0.0f });
+	this->Entities.Colliders.Add(Player1, paddleCollider);
+	this->Entities.Colliders.Add(Player2, paddleCollider);
+	this->Entities.Scores.Add(Player1, noScore);
+	this->Entities.Scores.Add(Player2, noScore);
+	this->ResetPlayer1();
+	this->ResetPlayer2();
+	float radius = this->Levels[this->Level].BallRadius;
+	this->Entities.Transforms.Add(Ball, { glm::vec2(0.0f), glm::vec2(radius * 2.0f), 0.0f });
+	this->Entities.Kinematics.Add(Ball, { glm::vec2(0.0f), true, 0 });
+	this->Entities.Colliders.Add(Ball, { COLLIDER_CIRCLE, radius });
+	// cells of two ball diameters: a ball touches at most four of them, a paddle six
+	Broadphase = new UniformGrid();
+	Broadphase->Init(glm::vec2(this->Width, this->Height), 4.0f * BALL_RADIUS);
 
-	// audio
-	SoundEngine->play2D("audio/soundtrack.mp3", true);
+	// set default selected player as player 1
+	this->ServeBall(true);
 }
 
 void Game::Update(float dt)
 {
+	PROFILE_SCOPE("Update");
 	// update objects
-	Ball->Move(dt, this->Height, this->isPlayer1);
+	if (this->FixedPoint)
+	{
+		FixedMoveSystem(this->Entities, Fixed::FromFloat(dt), Fixed::FromInt(this->Height), this->isPlayer1);
+		FixedSyncSystem(this->Entities);
+	}
+	else
+		MoveSystem(this->Entities, dt, this->Height, this->isPlayer1);
 	// check for collisions
 	this->DoCollisions();
-	// update particles
-	Particles->Update(dt, *Ball, 2, glm::vec2(Ball->Radius / 2.0f));
-	// check loss condition - player1
-	if (Ball->Position.x >= this->Width) // did ball reach right edge?
+	// update particles (not created when running the simulation only)
+	const Transform &ball = this->Entities.Transforms.Get(Ball);
+	glm::vec2 velocity = this->Entities.Kinematics.Get(Ball).Velocity;
+	glm::vec2 offset(this->Entities.Colliders.Get(Ball).Radius / 2.0f);
+	if (GpuParticles)
 	{
-		Player2->Score++;
-		this->ResetPlayer1Game();
-		this->ResetPlayer2();
-		SoundEngine->play2D("audio/plog.ogg", false);
+		// keep the trail as dense as the CPU one: 2 spawns per frame for every 500 particles
+		PROFILE_GPU_SCOPE("Particles");
+		GpuParticles->Update(dt, ball.Position, velocity, trailSpawns(this->GpuParticleCount, 1.0f), offset);
 	}
-	// check loss condition - player2
-	if (Ball->Position.x <= 0.0f) // did ball reach right edge?
+	else if (Particles)
 	{
-		Player1->Score++;
-		this->ResetPlayer2Game();
-		this->ResetPlayer1();
-		SoundEngine->play2D("audio/plog.ogg", false);
+		PROFILE_SCOPE("Particles");
+		Particles->Update(dt, ball.Position, velocity, trailSpawns(this->ParticleCount, QualityGovernor::MaxParticles()), offset);
 	}
-
-	// check win condition
-	if (this->State == GAME_ACTIVE)
+	// check loss conditions; in multi-ball mode every ball that leaves the field scores and
+	// is removed, and only the last one starts the next serve
+	for (unsigned int i = this->Entities.Kinematics.Size(); i-- > 0; )
 	{
-		if (Player1->Score == WIN_SCORE)
+		Entity entity = this->Entities.Kinematics.Entities[i];
+		float x = this->Entities.Transforms.Get(entity).Position.x;
+		bool player1Lost = x >= this->Width; // did ball reach right edge?
+		if (!player1Lost && x > 0.0f)
+			continue;
+		// points only count while a match is on, and the first to WIN_SCORE wins: in multi-ball
+		// mode several balls can score in one update
+		if (this->State == GAME_ACTIVE && ++this->Entities.Scores.Get(player1Lost ? Player2 : Player1).Points >= WIN_SCORE)
 		{
-			Player1Win = true;
+			Player1Win = !player1Lost;
 			this->State = GAME_WIN;
 		}
-			
-		if (Player2->Score == WIN_SCORE)
+		if (Audio)
+			Audio->Play(PlogSound);
+		if (this->Entities.Kinematics.Size() > 1)
 		{
-			Player1Win = false;
-			this->State = GAME_WIN;
+			this->Entities.Destroy(entity);
+			if (entity == Ball)
+				Ball = this->Entities.Kinematics.Entities[0];
+		}
+		else if (player1Lost)
+		{
+			this->ResetPlayer1Game();
+			this->ResetPlayer2();
+		}
+		else
+		{
+			this->ResetPlayer2Game();
+			this->ResetPlayer1();
 		}
 	}
 }
 
+// moves a paddle one step up or down unless it is past that edge already; the ball
+// waiting on the paddle moves along
+static void movePaddle(Game &game, Entity paddle, bool down, float dt)
+{
+	Transform &box = game.Entities.Transforms.Get(paddle);
+	bool carry = game.Entities.Kinematics.Get(Ball).Stuck && (paddle == Player1) == game.isPlayer1;
+	if (game.FixedPoint)
+	{
+		FixedBody &body = game.Entities.FixedBodies.Get(paddle);
+		if (down ? body.Position.y > Fixed::FromInt(game.Height) - Fixed::FromFloat(box.Size.y) : body.Position.y < Fixed::FromInt(0))
+			return;
+		Fixed velocity = Fixed::FromFloat(PLAYER_VELOCITY) * Fixed::FromFloat(dt);
+		body.Position.y += down ? velocity : -velocity;
+		if (carry)
+			game.Entities.FixedBodies.Get(Ball).Position.y += down ? velocity : -velocity;
+		return;
+	}
+	if (down ? box.Position.y > game.Height - box.Size.y : box.Position.y < 0.0f)
+		return;
+	float velocity = PLAYER_VELOCITY * dt;
+	box.Position.y += down ? velocity : -velocity;
+	if (carry)
+		game.Entities.Transforms.Get(Ball).Position.y += down ? velocity : -velocity;
+}
+
 void Game::ProcessInput(float dt)
 {
+	PROFILE_SCOPE("ProcessInput");
+#ifdef PINGPONG_PROFILE
+	// toggle the frame-time overlay
+	if (this->Keys[GLFW_KEY_F3] && !this->KeysProcessed[GLFW_KEY_F3])
+	{
+		this->ShowProfiler = !this->ShowProfiler;
+		this->KeysProcessed[GLFW_KEY_F3] = true;
+	}
+#endif
 	if (this->State == GAME_ACTIVE)
 	{
-		float velocity = PLAYER_VELOCITY * dt;
 		// move player1board
 		if (this->Keys[GLFW_KEY_UP])
-		{
-			if (Player1->Position.y >= 0.0f)
-			{
-				Player1->Position.y -= velocity;
-				if (Ball->Stuck && this->isPlayer1)
-					Ball->Position.y -= velocity;
-			}
-		}
+			movePaddle(*this, Player1, false, dt);
 		if (this->Keys[GLFW_KEY_DOWN])
-		{
-			if (Player1->Position.y <= this->Height - PLAYER_SIZE.y)
-			{
-				Player1->Position.y += velocity;
-				if (Ball->Stuck && this->isPlayer1)
-					Ball->Position.y += velocity;
-			}
-		}
+			movePaddle(*this, Player1, true, dt);
 		// move player2board
 		if (this->Keys[GLFW_KEY_W])
-		{
-			if (Player2->Position.y >= 0.0f)
-			{
-				Player2->Position.y -= velocity;
-				if (Ball->Stuck && !this->isPlayer1)
-					Ball->Position.y -= velocity;
-			}
-		}
+			movePaddle(*this, Player2, false, dt);
 		if (this->Keys[GLFW_KEY_S])
-		{
-			if (Player2->Position.y <= this->Height - PLAYER_SIZE.y)
-			{
-				Player2->Position.y += velocity;
-				if (Ball->Stuck && !this->isPlayer1)
-					Ball->Position.y += velocity;
-			}
-		}
+			movePaddle(*this, Player2, true, dt);
+		if (this->FixedPoint)
+			FixedSyncSystem(this->Entities);
 		// serve
 		if (this->Keys[GLFW_KEY_SPACE] && !this->KeysProcessed[GLFW_KEY_SPACE])
 		{
-			Ball->Stuck = false;
+			for (Kinematic &body : this->Entities.Kinematics.Dense)
+				body.Stuck = false;
 			this->KeysProcessed[GLFW_KEY_SPACE] = true;
 		}
 	}
@@ -205,35 +400,19 @@ void Game::ProcessInput(float dt)
 		}
 		// select player to serve
 		if (this->Keys[GLFW_KEY_RIGHT] && !this->KeysProcessed[GLFW_KEY_RIGHT])
-		{
-			Ball = this->Levels[this->Level].getBall1();
-			this->isPlayer1 = true;
-		}
+			this->ServeBall(true);
 		if (this->Keys[GLFW_KEY_LEFT] && !this->KeysProcessed[GLFW_KEY_LEFT])
-		{
-			Ball = this->Levels[this->Level].getBall2();
-			this->isPlayer1 = false;
-		}
+			this->ServeBall(false);
 		// select level difficulty
 		if (this->Keys[GLFW_KEY_D] && !this->KeysProcessed[GLFW_KEY_D])
 		{
-			this->Level = (this->Level + 1) % 4;
+			this->SelectLevel((this->Level + 1) % this->Levels.size());
 			this->KeysProcessed[GLFW_KEY_D] = true;
-
-			// set default selected player as player 1
-			Ball = this->Levels[this->Level].getBall1();
-			this->isPlayer1 = true;
 		}
 		if (this->Keys[GLFW_KEY_A] && !this->KeysProcessed[GLFW_KEY_A])
 		{
-			if (this->Level > 0)
-				--this->Level;
-			else
-				this->Level = 3;
+			this->SelectLevel(this->Level > 0 ? this->Level - 1 : static_cast<unsigned int>(this->Levels.size()) - 1);
 			this->KeysProcessed[GLFW_KEY_A] = true;
-
-			// set default selected player as player 1
-			Ball = this->Levels[this->Level].getBall1();
 		}
 	}
 	
@@ -250,167 +429,487 @@ void Game::ProcessInput(float dt)
 
 void Game::Render()
 {
-	if (this->State == GAME_ACTIVE || this->State == GAME_MENU)
+	PROFILE_SCOPE("Render");
+	// transient render data of the previous frame is no longer needed
+	FrameArena::Reset();
+	if (Quality && Quality->Frame())
+		applyQualityTier(*this);
+	bool scene = this->State == GAME_ACTIVE || this->State == GAME_MENU;
+	if (scene && Scaler && !Quality && this->DynamicResolution)
 	{
-		// draw background
-		Renderer->DrawSprite(ResourceManager::GetTexture("background"),
-			glm::vec2(0.0f, 0.0f), glm::vec2(this->Width, this->Height), 0.0f
-		);
-
-		// draw particles	
-		Particles->Draw();
-
-		// draw ball
-		Ball->Draw(*Renderer);
-
-		// draw player one
-		Player1->Draw(*Renderer);
-
-		// draw player two
-		Player2->Draw(*Renderer);
-
-		// render text
-		std::stringstream ss; ss << LEVEL_DIFFICULTY[Level];
-		Text->RenderText("Difficulty: " + ss.str(), 45.0f, 20.0f, 0.93f);
+		Scaler->Govern();
+		this->ResolutionScale = Scaler->Scale;
 	}
-
-	if (this->State == GAME_ACTIVE && Ball->Stuck) {
-		Text->RenderText(
-			"Press SPACE to serve!", 245.0, Height / 2, 1.5f, glm::vec3(1.0, 1.0, 0.0)
-		);
+	// at full scale the scene is drawn straight to the output, without the upscale pass
+	bool scaled = scene && Scaler && Scaler->Scale < 1.0f;
+	if (scaled)
+		Scaler->Begin();
+	if (scene)
+		drawScene(*this);
+	if (scaled)
+	{
+		PROFILE_GPU_SCOPE("Upscale");
+		Scaler->End();
 	}
-
-	if (this->State == GAME_ACTIVE || this->State == GAME_MENU || this->State == GAME_WIN)
+	if (scene)
 	{
-		std::stringstream ss2; ss2 << Player2->Score;
-		(Player2->Score > 9) ? Text_->RenderText(ss2.str(), 345.0f, 30.0f, 0.85) : Text_->RenderText(ss2.str(), 380.0f, 30.0f, 0.85);
-
-		std::stringstream ss1; ss1 << Player1->Score;
-		Text_->RenderText(ss1.str(), 480.0f, 30.0f, 0.85);
+		// render text at the window's resolution; formatted into stack buffers so steady-state frames do not allocate
+		PROFILE_GPU_SCOPE("Text");
+		char difficulty[48];
+		snprintf(difficulty, sizeof(difficulty), "Difficulty: %s", this->Levels[this->Level].Name.c_str());
+		Text->RenderText(difficulty, 45.0f, 20.0f, 0.93f);
 	}
 
-	if (this->State == GAME_MENU)
+	// serve prompt, scores and the menu and win screens
 	{
-		Text_->RenderText("PING PONG", 250.0f, Height / 2 - 20.0f, 1.0f);
+		PROFILE_GPU_SCOPE("HUD");
+		if (this->State == GAME_ACTIVE && this->Entities.Kinematics.Get(Ball).Stuck) {
+			Text->RenderText(
+				"Press SPACE to serve!", 245.0, Height / 2, 1.5f, glm::vec3(1.0, 1.0, 0.0)
+			);
+		}
+
+		if (this->State == GAME_ACTIVE || this->State == GAME_MENU || this->State == GAME_WIN)
+		{
+			unsigned int score1 = this->Entities.Scores.Get(Player1).Points;
+			unsigned int score2 = this->Entities.Scores.Get(Player2).Points;
+			char score[16];
+			snprintf(score, sizeof(score), "%u", score2);
+			(score2 > 9) ? Text_->RenderText(score, 345.0f, 30.0f, 0.85) : Text_->RenderText(score, 380.0f, 30.0f, 0.85);
+
+			snprintf(score, sizeof(score), "%u", score1);
+			Text_->RenderText(score, 480.0f, 30.0f, 0.85);
+		}
+
+		if (this->State == GAME_MENU)
+		{
+			Text_->RenderText("PING PONG", 250.0f, Height / 2 - 20.0f, 1.0f);
 
-		Text->RenderText("Press ENTER to start and ESC to quit", 467.0f, Height / 2 + 80.0f, 0.80f);
-		Text->RenderText("Press A or D to select Difficulty", 120.0f, Height / 2 + 80.0f, 0.80f);
+			Text->RenderText("Press ENTER to start and ESC to quit", 467.0f, Height / 2 + 80.0f, 0.80f);
+			Text->RenderText("Press A or D to select Difficulty", 120.0f, Height / 2 + 80.0f, 0.80f);
 
-		Text->RenderText("Press LEFT ARROW to make Player 2 serve", 50.0f, 500.0f, 0.80f);
-		Text->RenderText("Use W or S to move", 50.0f, 520.0f, 0.80f);
+			Text->RenderText("Press LEFT ARROW to make Player 2 serve", 50.0f, 500.0f, 0.80f);
+			Text->RenderText("Use W or S to move", 50.0f, 520.0f, 0.80f);
 
-		Text->RenderText("Press RIGHT ARROW to make Player 1 serve", 467.0f, 500.0f, 0.80f);
-		Text->RenderText("Use UP ARROW or DOWN ARROW to move", 467.0f, 520.0f, 0.80f);
+			Text->RenderText("Press RIGHT ARROW to make Player 1 serve", 467.0f, 500.0f, 0.80f);
+			Text->RenderText("Use UP ARROW or DOWN ARROW to move", 467.0f, 520.0f, 0.80f);
+		}
+
+		if (this->State == GAME_WIN)
+		{
+			(Player1Win) ? Text->RenderText(
+				"Player 1 WON!!!", 280.0, Height / 2 - 50.0f, 2.0f, glm::vec3(0.0, 1.0, 0.0)
+			) : Text->RenderText(
+				"Player 2 WON!!!", 280.0, Height / 2 - 50.0f, 2.0f, glm::vec3(0.0, 1.0, 0.0)
+			);
+			Text->RenderText(
+				"Press ENTER to replay and ESC to quit", 245.0, Height / 2 + 20, 1.0f, glm::vec3(1.0, 1.0, 0.0)
+			);
+		}
 	}
 
-	if (this->State == GAME_WIN)
+#ifdef PINGPONG_PROFILE
+	if (this->ShowProfiler)
 	{
-		(Player1Win) ? Text->RenderText(
-			"Player 1 WON!!!", 280.0, Height / 2 - 50.0f, 2.0f, glm::vec3(0.0, 1.0, 0.0)
-		) : Text->RenderText(
-			"Player 2 WON!!!", 280.0, Height / 2 - 50.0f, 2.0f, glm::vec3(0.0, 1.0, 0.0)
-		);
-		Text->RenderText(
-			"Press ENTER to replay and ESC to quit", 245.0, Height / 2 + 20, 1.0f, glm::vec3(1.0, 1.0, 0.0)
-		);
+		FrameStats stats = Profiler::Stats();
+		char line[64];
+		snprintf(line, sizeof(line), "frame p50 %5.2f ms  p99 %5.2f ms", stats.P50, stats.P99);
+		Text->RenderText(line, 590.0f, 560.0f, 0.7f, glm::vec3(1.0f, 1.0f, 0.0f));
+		snprintf(line, sizeof(line), "gpu   p50 %5.2f ms  p99 %5.2f ms", stats.GpuP50, stats.GpuP99);
+		Text->RenderText(line, 590.0f, 578.0f, 0.7f, glm::vec3(1.0f, 1.0f, 0.0f));
+		if (AllocationTracker::Enabled())
+		{
+			snprintf(line, sizeof(line), "allocations/frame %u", stats.MaxAllocations);
+			Text->RenderText(line, 590.0f, 542.0f, 0.7f, glm::vec3(1.0f, 1.0f, 0.0f));
+		}
+		if (Scaler)
+		{
+			snprintf(line, sizeof(line), "resolution %3.0f%%", Scaler->Scale * 100.0f);
+			Text->RenderText(line, 590.0f, 524.0f, 0.7f, glm::vec3(1.0f, 1.0f, 0.0f));
+		}
+		if (Quality)
+		{
+			snprintf(line, sizeof(line), "quality %s", Quality->Current().Name);
+			Text->RenderText(line, 590.0f, 506.0f, 0.7f, glm::vec3(1.0f, 1.0f, 0.0f));
+		}
 	}
+#endif
 }
 
 void Game::ResetPlayer1Game()
 {
-	Player1->Position = glm::vec2(
-		this->Width - PLAYER_SIZE.x - 5.0f,
-		this->Height / 2.0f - PLAYER_SIZE.y / 2.0f
-	);
-	Ball->Reset(Player1->Position + glm::vec2(-BALL_RADIUS * 2.0f, PLAYER_SIZE.y / 2.0f - BALL_RADIUS), this->Levels[this->Level].getBall1()->Velocity);
-	this->isPlayer1 = true;
+	this->ResetPlayer1();
+	this->ServeBall(true);
 }
 
 void Game::ResetPlayer2Game()
 {
-	Player2->Position = glm::vec2(
-		0.0f + 5.0f,
-		this->Height / 2.0f - PLAYER_SIZE.y / 2.0f
-	);
-	Ball->Reset(Player2->Position + glm::vec2(BALL_RADIUS * 2.0f, PLAYER_SIZE.y / 2.0f - BALL_RADIUS), this->Levels[this->Level].getBall2()->Velocity);
-	this->isPlayer1 = false;
+	this->ResetPlayer2();
+	this->ServeBall(false);
 }
 
 void Game::ResetPlayer1()
 {
-	Player1->Position = glm::vec2(
-		this->Width - PLAYER_SIZE.x - 5.0f,
-		this->Height / 2.0f - PLAYER_SIZE.y / 2.0f
+	Transform &player1 = this->Entities.Transforms.Get(Player1);
+	player1.Size = this->Levels[this->Level].PaddleSize;
+	player1.Position = glm::vec2(
+		this->Width - player1.Size.x - 5.0f,
+		this->Height / 2.0f - player1.Size.y / 2.0f
 	);
+	if (this->FixedPoint)
+		this->Entities.FixedBodies.Add(Player1, { FixedVec2::FromFloat(player1.Position), FixedVec2() });
 }
 
 void Game::ResetPlayer2()
 {
-	Player2->Position = glm::vec2(
+	Transform &player2 = this->Entities.Transforms.Get(Player2);
+	player2.Size = this->Levels[this->Level].PaddleSize;
+	player2.Position = glm::vec2(
 		0.0f + 5.0f,
-		this->Height / 2.0f - PLAYER_SIZE.y / 2.0f
+		this->Height / 2.0f - player2.Size.y / 2.0f
 	);
-
+	if (this->FixedPoint)
+		this->Entities.FixedBodies.Add(Player2, { FixedVec2::FromFloat(player2.Position), FixedVec2() });
 }
 
 void Game::ResetGame()
 {
 	this->ResetPlayer1Game();
 	this->ResetPlayer2();
-	Player1->Score = 0;
-	Player2->Score = 0;
+	this->Entities.Scores.Get(Player1).Points = 0;
+	this->Entities.Scores.Get(Player2).Points = 0;
 }
 
-// collision detection
-Collision CheckCollision(BallObject &one, GameObject &two);
-Direction VectorDirection(glm::vec2 closest);
+void Game::SelectLevel(unsigned int level)
+{
+	this->Level = std::min(level, static_cast<unsigned int>(this->Levels.size()) - 1);
+	// the level sets the paddle size; set default selected player as player 1
+	this->ResetPlayer1();
+	this->ResetPlayer2();
+	this->ServeBall(true);
+}
 
-void Game::DoCollisions()
+void Game::ServeBall(bool player1)
 {
-	// check collisions for player one paddle
-	Collision result = CheckCollision(*Ball, *Player1);
-	if (!Ball->Stuck && std::get<0>(result))
+	const GameLevel &level = this->Levels[this->Level];
+	const Transform &paddle = this->Entities.Transforms.Get(player1 ? Player1 : Player2);
+	float radius = level.BallRadius;
+	// only the lead ball is kept from the previous serve
+	for (unsigned int i = this->Entities.Kinematics.Size(); i-- > 0; )
+		if (this->Entities.Kinematics.Entities[i] != Ball)
+			this->Entities.Destroy(this->Entities.Kinematics.Entities[i]);
+	// the ball sits in front of the paddle's center, on the side facing the field
+	glm::vec2 offset(player1 ? -radius * 2.0f : radius * 2.0f, paddle.Size.y / 2.0f - radius);
+	glm::vec2 position = paddle.Position + offset;
+	Transform &ball = this->Entities.Transforms.Get(Ball);
+	ball.Position = position;
+	ball.Size = glm::vec2(radius * 2.0f);
+	this->Entities.Colliders.Get(Ball).Radius = radius;
+	glm::vec2 serve = level.Speed(0) * INITIAL_BALL_VELOCITY;
+	Kinematic &body = this->Entities.Kinematics.Get(Ball);
+	body.Velocity = serve;
+	body.Stuck = true;
+	body.Hits = 0;
+	this->isPlayer1 = player1;
+	// in fixed point the ball starts from the paddle's exact position
+	FixedVec2 fixedPosition, fixedServe;
+	if (this->FixedPoint)
+	{
+		fixedPosition = this->Entities.FixedBodies.Get(player1 ? Player1 : Player2).Position + FixedVec2::FromFloat(offset);
+		fixedServe = FixedVec2::FromFloat(INITIAL_BALL_VELOCITY) * level.FixedSpeed(0);
+		this->Entities.FixedBodies.Add(Ball, { fixedPosition, fixedServe });
+	}
+	// multi-ball: the others fill columns of the field's height behind it, each row served
+	// at a different angle (up to 30 degrees off the level's direction) so they spread out
+	float spacing = radius * 2.0f + 4.0f;
+	unsigned int rows = std::max(1u, static_cast<unsigned int>(this->Height / spacing));
+	float top = (this->Height - rows * spacing) / 2.0f + 2.0f;
+	for (unsigned int i = 1; i < this->BallCount; ++i)
 	{
-		SoundEngine->play2D("audio/bleep.mp3", false);
-		// check where it hit the board, and change velocity based on where it hit the board
-		float centerBoard = Player1->Position.y + Player1->Size.y / 2.0f;
-		float distance = (Ball->Position.y + Ball->Radius) - centerBoard;
-		float percentage = distance / (Player1->Size.y / 2.0f);
-		// then move accordingly
-		float strength = 2.0f;
-		glm::vec2 oldVelocity = Ball->Velocity;
-		Ball->Velocity.y = INITIAL_BALL_VELOCITY.y * percentage * strength;
-		
-		Ball->Velocity.x = -1.0f * Ball->Velocity.x;
-		Ball->Velocity = glm::normalize(Ball->Velocity) * glm::length(oldVelocity);
+		unsigned int column = (i - 1) / rows + 1, row = (i - 1) % rows;
+		float angle = glm::radians(60.0f) * (rows > 1 ? static_cast<float>(row) / (rows - 1) - 0.5f : 0.0f);
+		glm::vec2 velocity(serve.x * cos(angle) - serve.y * sin(angle), serve.x * sin(angle) + serve.y * cos(angle));
+		Entity extra = this->Entities.Create();
+		this->Entities.Transforms.Add(extra, { glm::vec2(position.x + (player1 ? -spacing : spacing) * column, top + row * spacing),
+			glm::vec2(radius * 2.0f), 0.0f });
+		this->Entities.Kinematics.Add(extra, { velocity, true, 0 });
+		this->Entities.Colliders.Add(extra, { COLLIDER_CIRCLE, radius });
+		this->Entities.Sprites.Add(extra, { BallTexture, glm::vec3(1.0f) });
+		if (this->FixedPoint)
+		{
+			// the same placement in fixed point
+			Fixed fixedSpacing = Fixed::FromFloat(spacing);
+			Fixed fixedTop = (Fixed::FromInt(this->Height) - Fixed::FromRaw(fixedSpacing.Raw * static_cast<int>(rows))) / Fixed::FromInt(2) + Fixed::FromInt(2);
+			Fixed fraction = rows > 1 ? Fixed::FromInt(row) / Fixed::FromInt(rows - 1) - Fixed::FromRaw(32768) : Fixed::FromInt(0);
+			Fixed fixedAngle = Fixed::FromFloat(glm::radians(60.0f)) * fraction;
+			Fixed cosine = Cos(fixedAngle), sine = Sin(fixedAngle);
+			FixedVec2 velocity = { fixedServe.x * cosine - fixedServe.y * sine, fixedServe.x * sine + fixedServe.y * cosine };
+			Fixed columnOffset = Fixed::FromRaw(fixedSpacing.Raw * static_cast<int>(column));
+			FixedVec2 position = { fixedPosition.x + (player1 ? -columnOffset : columnOffset), fixedTop + Fixed::FromRaw(fixedSpacing.Raw * static_cast<int>(row)) };
+			this->Entities.FixedBodies.Add(extra, { position, velocity });
+		}
 	}
+	if (this->FixedPoint)
+		FixedSyncSystem(this->Entities);
+}
+
+void Game::Autopilot()
+{
+	// taps a key: pressed on one call, released (as key_callback would) on the next
+	auto tap = [this](int key) {
+		this->Keys[key] = !this->Keys[key];
+		if (!this->Keys[key])
+			this->KeysProcessed[key] = false;
+	};
+	if (this->State == GAME_MENU || this->State == GAME_WIN)
+	{
+		tap(GLFW_KEY_ENTER);
+		return;
+	}
+	if (this->Entities.Kinematics.Get(Ball).Stuck)
+		tap(GLFW_KEY_SPACE);
+	// each paddle follows the ball closest to its own edge
+	const Transform *nearest1 = nullptr, *nearest2 = nullptr;
+	for (Entity entity : this->Entities.Kinematics.Entities)
+	{
+		const Transform &ball = this->Entities.Transforms.Get(entity);
+		if (!nearest1 || ball.Position.x > nearest1->Position.x)
+			nearest1 = &ball;
+		if (!nearest2 || ball.Position.x < nearest2->Position.x)
+			nearest2 = &ball;
+	}
+	// keep each paddle's center within a few pixels of the ball's center
+	const Transform &player1 = this->Entities.Transforms.Get(Player1);
+	const Transform &player2 = this->Entities.Transforms.Get(Player2);
+	float ballCenter1 = nearest1->Position.y + nearest1->Size.y / 2.0f;
+	float ballCenter2 = nearest2->Position.y + nearest2->Size.y / 2.0f;
+	float center1 = player1.Position.y + player1.Size.y / 2.0f;
+	float center2 = player2.Position.y + player2.Size.y / 2.0f;
+	this->Keys[GLFW_KEY_UP] = ballCenter1 < center1 - 10.0f;
+	this->Keys[GLFW_KEY_DOWN] = ballCenter1 > center1 + 10.0f;
+	this->Keys[GLFW_KEY_W] = ballCenter2 < center2 - 10.0f;
+	this->Keys[GLFW_KEY_S] = ballCenter2 > center2 + 10.0f;
+}
+
+// bounces ball off paddle if they touch, steering it by where it hit the paddle and
+// speeding it up along the level's speed curve
+static void paddleHit(EntityStore &entities, const GameLevel &level, Entity ball, Entity paddle)
+{
+	const Transform &circle = entities.Transforms.Get(ball);
+	const Transform &box = entities.Transforms.Get(paddle);
+	float radius = entities.Colliders.Get(ball).Radius;
+	Collision result = CheckCollision(circle, radius, box);
+	if (!std::get<0>(result))
+		return;
+	if (Audio)
+		Audio->Play(BleepSound);
+	// check where it hit the board, and change velocity based on where it hit the board
+	float centerBoard = box.Position.y + box.Size.y / 2.0f;
+	float distance = (circle.Position.y + radius) - centerBoard;
+	float percentage = distance / (box.Size.y / 2.0f);
+	// then move accordingly
+	float strength = 2.0f;
+	Kinematic &body = entities.Kinematics.Get(ball);
+	glm::vec2 oldVelocity = body.Velocity;
+	body.Velocity.y = INITIAL_BALL_VELOCITY.y * percentage * strength;
+
+	body.Velocity.x = -1.0f * body.Velocity.x;
+	float speedUp = level.Speed(body.Hits + 1) / level.Speed(body.Hits);
+	body.Velocity = glm::normalize(body.Velocity) * (glm::length(oldVelocity) * speedUp);
+	++body.Hits;
+}
+
+// bounces ball off every obstacle of the level it touches; the grid only hands out the ones near it
+static void obstacleHits(EntityStore &entities, const GameLevel &level, Entity ball)
+{
+	Transform &circle = entities.Transforms.Get(ball);
+	float radius = entities.Colliders.Get(ball).Radius;
+	Kinematic &body = entities.Kinematics.Get(ball);
+	level.ObstacleGrid.ForEachOverlap(circle.Position, circle.Position + circle.Size, [&](unsigned int obstacle) {
+		Collision result = CheckCollision(circle, radius, level.Obstacles[obstacle]);
+		if (!std::get<0>(result))
+			return;
+		// reverse the velocity on the side it hit and move the ball out of the block
+		Direction dir = std::get<1>(result);
+		glm::vec2 diff_vector = std::get<2>(result);
+		if (dir == LEFT || dir == RIGHT) // horizontal collision
+		{
+			body.Velocity.x = -body.Velocity.x;
+			float penetration = radius - std::abs(diff_vector.x);
+			if (dir == LEFT)
+				circle.Position.x += penetration; // move ball to right
+			else
+				circle.Position.x -= penetration; // move ball to left
+		}
+		else // vertical collision
+		{
+			body.Velocity.y = -body.Velocity.y;
+			float penetration = radius - std::abs(diff_vector.y);
+			if (dir == UP)
+				circle.Position.y -= penetration; // move ball back up
+			else
+				circle.Position.y += penetration; // move ball back down
+		}
+	});
+}
+
+// elastic collision of two equal balls: pushes them apart and, if they are closing in,
+// exchanges their velocities along the line between their centers
+static void ballHit(EntityStore &entities, Entity a, Entity b, bool reversed)
+{
+	Transform &transformA = entities.Transforms.Get(a);
+	Transform &transformB = entities.Transforms.Get(b);
+	float radiusA = entities.Colliders.Get(a).Radius;
+	float radiusB = entities.Colliders.Get(b).Radius;
+	glm::vec2 difference = (transformB.Position + radiusB) - (transformA.Position + radiusA);
+	float distance = glm::length(difference);
+	if (distance >= radiusA + radiusB || distance == 0.0f)
+		return;
+	glm::vec2 normal = difference / distance;
+	glm::vec2 overlap = normal * ((radiusA + radiusB - distance) / 2.0f);
+	transformA.Position -= overlap;
+	transformB.Position += overlap;
+	// velocities point against the motion while the balls move reversed
+	Kinematic &bodyA = entities.Kinematics.Get(a);
+	Kinematic &bodyB = entities.Kinematics.Get(b);
+	float closing = glm::dot(bodyA.Velocity - bodyB.Velocity, normal);
+	if ((reversed ? -closing : closing) <= 0.0f)
+		return;
+	bodyA.Velocity -= closing * normal;
+	bodyB.Velocity += closing * normal;
+}
+
+// paddleHit in fixed point
+static void fixedPaddleHit(EntityStore &entities, const GameLevel &level, Entity ball, Entity paddle)
+{
+	FixedBody &body = entities.FixedBodies.Get(ball);
+	FixedVec2 boxPosition = entities.FixedBodies.Get(paddle).Position;
+	FixedVec2 boxSize = FixedVec2::FromFloat(entities.Transforms.Get(paddle).Size);
+	Fixed radius = Fixed::FromFloat(entities.Colliders.Get(ball).Radius);
+	FixedCollision result = CheckCollision(body.Position, radius, boxPosition, boxSize);
+	if (!std::get<0>(result))
+		return;
+	if (Audio)
+		Audio->Play(BleepSound);
+	Fixed halfHeight = boxSize.y / Fixed::FromInt(2);
+	Fixed percentage = (body.Position.y + radius - (boxPosition.y + halfHeight)) / halfHeight;
+	Kinematic &kinematic = entities.Kinematics.Get(ball);
+	FixedVec2 oldVelocity = body.Velocity;
+	body.Velocity.y = Fixed::FromFloat(INITIAL_BALL_VELOCITY.y) * percentage * Fixed::FromInt(2);
+	body.Velocity.x = -body.Velocity.x;
+	Fixed speedUp = level.FixedSpeed(kinematic.Hits + 1) / level.FixedSpeed(kinematic.Hits);
+	body.Velocity = Normalize(body.Velocity) * (Length(oldVelocity) * speedUp);
+	++kinematic.Hits;
+}
+
+// obstacleHits in fixed point
+static void fixedObstacleHits(EntityStore &entities, const GameLevel &level, Entity ball)
+{
+	FixedBody &body = entities.FixedBodies.Get(ball);
+	const Transform &circle = entities.Transforms.Get(ball);
+	Fixed radius = Fixed::FromFloat(entities.Colliders.Get(ball).Radius);
+	level.ObstacleGrid.ForEachOverlap(circle.Position, circle.Position + circle.Size, [&](unsigned int obstacle) {
+		const Transform &box = level.Obstacles[obstacle];
+		FixedCollision result = CheckCollision(body.Position, radius, FixedVec2::FromFloat(box.Position), FixedVec2::FromFloat(box.Size));
+		if (!std::get<0>(result))
+			return;
+		Direction dir = std::get<1>(result);
+		FixedVec2 difference = std::get<2>(result);
+		if (dir == LEFT || dir == RIGHT)
+		{
+			body.Velocity.x = -body.Velocity.x;
+			Fixed penetration = radius - Abs(difference.x);
+			body.Position.x += dir == LEFT ? penetration : -penetration;
+		}
+		else
+		{
+			body.Velocity.y = -body.Velocity.y;
+			Fixed penetration = radius - Abs(difference.y);
+			body.Position.y += dir == UP ? -penetration : penetration;
+		}
+	});
+}
+
+// ballHit in fixed point
+static void fixedBallHit(EntityStore &entities, Entity a, Entity b, bool reversed)
+{
+	FixedBody &bodyA = entities.FixedBodies.Get(a);
+	FixedBody &bodyB = entities.FixedBodies.Get(b);
+	Fixed radiusA = Fixed::FromFloat(entities.Colliders.Get(a).Radius);
+	Fixed radiusB = Fixed::FromFloat(entities.Colliders.Get(b).Radius);
+	FixedVec2 centerA = { bodyA.Position.x + radiusA, bodyA.Position.y + radiusA };
+	FixedVec2 centerB = { bodyB.Position.x + radiusB, bodyB.Position.y + radiusB };
+	FixedVec2 difference = centerB - centerA;
+	Fixed distance = Length(difference);
+	if (distance >= radiusA + radiusB || distance == Fixed::FromInt(0))
+		return;
+	FixedVec2 normal = difference / distance;
+	FixedVec2 overlap = normal * ((radiusA + radiusB - distance) / Fixed::FromInt(2));
+	bodyA.Position -= overlap;
+	bodyB.Position += overlap;
+	Fixed closing = Dot(bodyA.Velocity - bodyB.Velocity, normal);
+	if ((reversed ? -closing : closing) <= Fixed::FromInt(0))
+		return;
+	bodyA.Velocity -= normal * closing;
+	bodyB.Velocity += normal * closing;
+}
 
-	// check collisions for player two paddle
-	result = CheckCollision(*Ball, *Player2);
-	if (!Ball->Stuck && std::get<0>(result))
+void Game::DoCollisions()
+{
+	PROFILE_SCOPE("DoCollisions");
+	// broadphase: bucket every collider into the grid, then only the pairs sharing a cell are tested
+	Broadphase->Clear();
+	for (unsigned int i = 0; i < this->Entities.Colliders.Size(); ++i)
+	{
+		const Transform &transform = this->Entities.Transforms.Get(this->Entities.Colliders.Entities[i]);
+		Broadphase->Insert(this->Entities.Colliders.Entities[i], transform.Position, transform.Position + transform.Size);
+	}
+	Broadphase->Build();
+	Broadphase->ForEachPair([this](Entity a, Entity b) {
+		// order the pair as ball first; paddles never collide with each other
+		if (this->Entities.Colliders.Get(a).Shape != COLLIDER_CIRCLE)
+			std::swap(a, b);
+		const Kinematic *bodyA = this->Entities.Kinematics.Find(a);
+		if (this->Entities.Colliders.Get(a).Shape != COLLIDER_CIRCLE || !bodyA || bodyA->Stuck)
+			return;
+		if (this->Entities.Colliders.Get(b).Shape == COLLIDER_BOX)
+		{
+			if (this->FixedPoint)
+				fixedPaddleHit(this->Entities, this->Levels[this->Level], a, b);
+			else
+				paddleHit(this->Entities, this->Levels[this->Level], a, b);
+			return;
+		}
+		const Kinematic *bodyB = this->Entities.Kinematics.Find(b);
+		if (!bodyB || bodyB->Stuck)
+			return;
+		if (this->FixedPoint)
+			fixedBallHit(this->Entities, a, b, this->isPlayer1);
+		else
+			ballHit(this->Entities, a, b, this->isPlayer1);
+	});
+	// the level's static obstacles have a grid of their own, built when the level was loaded
+	const GameLevel &level = this->Levels[this->Level];
+	for (unsigned int i = 0; i < this->Entities.Kinematics.Size() && !level.Obstacles.empty(); ++i)
 	{
-		SoundEngine->play2D("audio/bleep.mp3", false);
-		// check where it hit the board, and change velocity based on where it hit the board
-		float centerBoard = Player2->Position.y + Player2->Size.y / 2.0f;
-		float distance = (Ball->Position.y + Ball->Radius) - centerBoard;
-		float percentage = distance / (Player2->Size.y / 2.0f);
-		// then move accordingly
-		float strength = 2.0f;
-		glm::vec2 oldVelocity = Ball->Velocity;
-		Ball->Velocity.y = INITIAL_BALL_VELOCITY.y * percentage * strength;
-
-		Ball->Velocity.x = -1.0f * Ball->Velocity.x;
-		Ball->Velocity = glm::normalize(Ball->Velocity) * glm::length(oldVelocity);
+		if (this->Entities.Kinematics.Dense[i].Stuck)
+			continue;
+		if (this->FixedPoint)
+			fixedObstacleHits(this->Entities, level, this->Entities.Kinematics.Entities[i]);
+		else
+			obstacleHits(this->Entities, level, this->Entities.Kinematics.Entities[i]);
 	}
+	if (this->FixedPoint)
+		FixedSyncSystem(this->Entities);
 }
 
-Collision CheckCollision(BallObject &one, GameObject &two) // AABB - Circle collision
+Collision CheckCollision(const Transform &circle, float radius, const Transform &box) // AABB - Circle collision
 {
 	// get center point circle first 
-	glm::vec2 center(one.Position + one.Radius);
+	glm::vec2 center(circle.Position + radius);
 	// calculate AABB info (center, half-extents)
-	glm::vec2 aabb_half_extents(two.Size.x / 2.0f, two.Size.y / 2.0f);
-	glm::vec2 aabb_center(two.Position.x + aabb_half_extents.x, two.Position.y + aabb_half_extents.y);
+	glm::vec2 aabb_half_extents(box.Size.x / 2.0f, box.Size.y / 2.0f);
+	glm::vec2 aabb_center(box.Position.x + aabb_half_extents.x, box.Position.y + aabb_half_extents.y);
 	// get difference vector between both centers
 	glm::vec2 difference = center - aabb_center;
 	glm::vec2 clamped = glm::clamp(difference, -aabb_half_extents, aabb_half_extents);
@@ -419,12 +918,25 @@ Collision CheckCollision(BallObject &one, GameObject &two) // AABB - Circle coll
 	// now retrieve vector between center circle and closest point AABB and check if length < radius
 	difference = closest - center;
 
-	if (glm::length(difference) < one.Radius) // not <= since in that case a collision also occurs when object one exactly touches object two, which they are at the end of each collision resolution stage.
+	if (glm::length(difference) < radius) // not <= since in that case a collision also occurs when object one exactly touches object two, which they are at the end of each collision resolution stage.
 		return std::make_tuple(true, VectorDirection(difference), difference);
 	else
 		return std::make_tuple(false, UP, glm::vec2(0.0f, 0.0f));
 }
 
+FixedCollision CheckCollision(FixedVec2 circle, Fixed radius, FixedVec2 boxPosition, FixedVec2 boxSize) // the same in fixed point
+{
+	FixedVec2 center = { circle.x + radius, circle.y + radius };
+	FixedVec2 halfExtents = boxSize / Fixed::FromInt(2);
+	FixedVec2 boxCenter = boxPosition + halfExtents;
+	FixedVec2 difference = center - boxCenter;
+	FixedVec2 clamped = { Max(-halfExtents.x, Min(difference.x, halfExtents.x)), Max(-halfExtents.y, Min(difference.y, halfExtents.y)) };
+	difference = boxCenter + clamped - center;
+	if (Length(difference) < radius)
+		return std::make_tuple(true, VectorDirection(difference), difference);
+	return std::make_tuple(false, UP, FixedVec2());
+}
+
 // calculates which direction a vector is facing (N,E,S or W)
 Direction VectorDirection(glm::vec2 target)
 {
@@ -446,4 +958,22 @@ Direction VectorDirection(glm::vec2 target)
 		}
 	}
 	return (Direction)best_match;
-}
\ No newline at end of file
+}
+
+// the same in fixed point: the dot products with the compass directions are the
+// components themselves, and normalizing does not change which one is largest
+Direction VectorDirection(FixedVec2 target)
+{
+	Fixed compass[] = { target.y, target.x, -target.y, -target.x }; // up, right, down, left
+	Fixed max = Fixed::FromInt(0);
+	unsigned int best_match = -1;
+	for (unsigned int i = 0; i < 4; i++)
+	{
+		if (compass[i] > max)
+		{
+			max = compass[i];
+			best_match = i;
+		}
+	}
+	return (Direction)best_match;
+}
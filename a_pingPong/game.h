@@ -1,14 +1,18 @@
 #ifndef GAME_H
 #define GAME_H
+#include <string>
 #include <vector>
 #include <tuple>
 
 #include <glm/glm.hpp>
 
+#include "entity_store.h"
 #include "game_level.h"
 
 #include <glad/glad.h>
-#include <GLFW/glfw3.h>
+#include "key_codes.h"
+
+struct AudioStats;
 
 // Represents the current state of the game
 enum GameState {
@@ -25,28 +29,24 @@ enum Direction {
 	LEFT
 };
 
-// Represents the four levels of difficulty
-const std::vector<std::string>  LEVEL_DIFFICULTY {
-	"Amateur",
-	"Pro",
-	"Expert",
-	"World Class"
-};
-
 // Defines a Collision typedef that represents collision data
 typedef std::tuple<bool, Direction, glm::vec2> Collision; // <collision?, what direction?, difference vector center - closest point>
+// the same in fixed point
+typedef std::tuple<bool, Direction, FixedVec2> FixedCollision;
 
-// Initial size of the player paddle
+// Size of the player paddle when no level file sets one
 //const glm::vec2 PLAYER_SIZE(105.0f, 25.0f);
-const glm::vec2 PLAYER_SIZE(25.0f, 105.0f);
+constexpr float PLAYER_WIDTH = 25.0f, PLAYER_HEIGHT = 105.0f;
+const glm::vec2 PLAYER_SIZE(PLAYER_WIDTH, PLAYER_HEIGHT);
 // Initial velocity of the player paddle
-const float PLAYER_VELOCITY(500.0f);
-// Initial velocity of the Ball
-const glm::vec2 INITIAL_BALL_VELOCITY(100.0f, -100.0f);
-// Radius of the ball object
-const float BALL_RADIUS = 13.0f;
+constexpr float PLAYER_VELOCITY = 500.0f;
+// Initial velocity of the Ball; levels set the speed as a multiple of it
+constexpr float INITIAL_BALL_SPEED = 100.0f;
+const glm::vec2 INITIAL_BALL_VELOCITY(INITIAL_BALL_SPEED, -INITIAL_BALL_SPEED);
+// Radius of the ball object when no level file sets one
+constexpr float BALL_RADIUS = 13.0f;
 // win score
-const int WIN_SCORE = 11;
+constexpr int WIN_SCORE = 11;
 
 // Game holds all game-related state and functionality.
 // Combines all game-related data into a single class for
@@ -62,23 +62,76 @@ public:
 	bool                    Keys[1024];
 	std::vector<GameLevel>  Levels;
 	unsigned int            Level;
+	// the balls and both paddles
+	EntityStore             Entities;
+	// balls in play at every serve (set before Init); more than one is the multi-ball mode
+	unsigned int            BallCount;
 	unsigned int            Width, Height;
+	// if set, the mixed sound effects are written to this .wav file instead of the sound device
+	std::string             AudioCapture;
+	// set to false before Init to run without any sound (headless runs)
+	bool                    AudioEnabled;
+	// set before Init to run the mixer without its thread and device: the caller then
+	// mixes the audio in step with the game through MixAudio (headless checks)
+	bool                    ManualAudio;
+	// size of the ball's particle trail (set before Init); large pools update on the JobSystem
+	unsigned int            ParticleCount;
+	// set before Init to simulate this many particles on the GPU instead (0 = CPU particles)
+	unsigned int            GpuParticleCount;
+	// set before Init to run the physics in Q16.16 fixed point (see fixed_point.h), so a
+	// match plays out bit for bit the same on every build; Entities then get FixedBodies
+	bool                    FixedPoint;
+	// set before Init to render the scene (not the text) at this fraction of the window's
+	// resolution, and DynamicResolution to let the measured frame times steer the fraction
+	// (ResolutionScale then follows the fraction in use)
+	float                   ResolutionScale;
+	bool                    DynamicResolution;
+	// set before Init to a frame time in ms to let a QualityGovernor step the particle trail
+	// and the scene resolution up and down to stay within it (0 = fixed quality; it overrides
+	// DynamicResolution); QualityTier follows the index of the tier in use
+	float                   QualityBudget;
+	unsigned int            QualityTier;
+#ifdef PINGPONG_PROFILE
+	// frame-time overlay, toggled with F3
+	bool                    ShowProfiler;
+#endif
 	// constructor/destructor
 	Game(unsigned int width, unsigned int height);
 	~Game();
 	// initialize game state (load all shaders/textures/levels)
 	void Init();
+	// initialize only the game objects and levels; needs no OpenGL context, so the
+	// simulation (ProcessInput/Update/DoCollisions) can run headless
+	void InitSimulation();
 	// game loop
 	void ProcessInput(float dt);
 	void Update(float dt);
 	void Render();
 	void DoCollisions();
+	// mixes the next frames of audio into out when ManualAudio is set; false without audio
+	bool MixAudio(short *out, unsigned int frames);
+	// the mixer's trigger statistics, or nullptr without audio
+	const AudioStats *AudioStatistics() const;
+	// steers both paddles towards the ball and presses ENTER/SPACE as needed,
+	// so unattended (headless) runs play real rallies; call before ProcessInput
+	void Autopilot();
 	// reset
 	void ResetPlayer1Game();
 	void ResetPlayer2Game();
 	void ResetPlayer1();
 	void ResetPlayer2();
 	void ResetGame();
+	// switches to another of the Levels (clamped to the last one) and puts the paddles and ball back
+	void SelectLevel(unsigned int level);
+	// puts the ball on the serving player's paddle with the level's serve velocity; in
+	// multi-ball mode the other balls wait in a block in front of it, fanned out in direction
+	void ServeBall(bool player1);
 };
 
+// collision detection
+Collision CheckCollision(const Transform &circle, float radius, const Transform &box);
+Direction VectorDirection(glm::vec2 closest);
+FixedCollision CheckCollision(FixedVec2 circle, Fixed radius, FixedVec2 boxPosition, FixedVec2 boxSize);
+Direction VectorDirection(FixedVec2 closest);
+
 #endif
\ No newline at end of file
@@ -1,18 +1,250 @@
 #include "game_level.h"
-#include "resource_manager.h"
 
-void GameLevel::Load(glm::vec2 ball1Pos, glm::vec2 ball2Pos, float ball_radius, glm::vec2 initial_ball_velocity)
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+// Level pack layout: a PackHeader, LevelCount PackLevels, then the obstacles
+// of all levels. Values are stored in the byte order of the machine that
+// compiled the pack, which is the one that runs it.
+static const char         PACK_MAGIC[4] = { 'P', 'P', 'L', 'V' };
+static const unsigned int PACK_VERSION = 1;
+
+struct PackHeader {
+	char         Magic[4];
+	unsigned int Version;
+	unsigned int LevelCount;
+	unsigned int ObstacleCount;
+};
+
+struct PackLevel {
+	char         Name[32];
+	float        BallRadius;
+	float        SpeedStart, SpeedPerHit, SpeedMax;
+	float        PaddleWidth, PaddleHeight;
+	unsigned int FirstObstacle, ObstacleCount;
+};
+
+struct PackObstacle {
+	float X, Y, Width, Height;
+};
+
+bool GameLevel::Load(const char *file)
+{
+	std::ifstream in(file);
+	if (!in)
+	{
+		std::cout << "ERROR::LEVEL: Failed to open " << file << std::endl;
+		return false;
+	}
+	// one setting per line: a keyword followed by its values; # starts a comment
+	*this = GameLevel();
+	std::string line;
+	for (unsigned int number = 1; std::getline(in, line); ++number)
+	{
+		line = line.substr(0, line.find('#'));
+		std::istringstream values(line);
+		std::string key;
+		if (!(values >> key))
+			continue;
+		bool valid = true;
+		if (key == "name")
+		{
+			std::getline(values >> std::ws, this->Name);
+			this->Name.erase(this->Name.find_last_not_of(" \t\r") + 1);
+			valid = !this->Name.empty() && this->Name.size() < sizeof(PackLevel::Name);
+		}
+		else if (key == "ball")
+			valid = static_cast<bool>(values >> this->BallRadius);
+		else if (key == "speed")
+		{
+			valid = static_cast<bool>(values >> this->SpeedStart);
+			// a constant speed may leave out the curve
+			if (!(values >> this->SpeedPerHit >> this->SpeedMax))
+			{
+				this->SpeedPerHit = 0.0f;
+				this->SpeedMax = this->SpeedStart;
+			}
+		}
+		else if (key == "paddle")
+			valid = static_cast<bool>(values >> this->PaddleSize.x >> this->PaddleSize.y);
+		else if (key == "obstacle")
+		{
+			Transform obstacle = { glm::vec2(0.0f), glm::vec2(0.0f), 0.0f };
+			valid = values >> obstacle.Position.x >> obstacle.Position.y >> obstacle.Size.x >> obstacle.Size.y
+				&& obstacle.Size.x > 0.0f && obstacle.Size.y > 0.0f;
+			this->Obstacles.push_back(obstacle);
+		}
+		else
+			valid = false;
+		if (!valid)
+		{
+			std::cout << "ERROR::LEVEL: " << file << ":" << number << ": invalid line: " << line << std::endl;
+			return false;
+		}
+	}
+	if (this->Name.empty() || this->BallRadius <= 0.0f || this->SpeedStart <= 0.0f || this->SpeedMax < this->SpeedStart
+		|| this->PaddleSize.x <= 0.0f || this->PaddleSize.y <= 0.0f)
+	{
+		std::cout << "ERROR::LEVEL: " << file << " needs a name, a ball radius, a speed and a paddle size" << std::endl;
+		return false;
+	}
+	return true;
+}
+
+float GameLevel::Speed(unsigned int hits) const
+{
+	return std::min(this->SpeedStart + this->SpeedPerHit * hits, this->SpeedMax);
+}
+
+Fixed GameLevel::FixedSpeed(unsigned int hits) const
+{
+	Fixed perHit = Fixed::FromFloat(this->SpeedPerHit);
+	return Min(Fixed::FromFloat(this->SpeedStart) + Fixed::FromRaw(perHit.Raw * static_cast<int>(hits)), Fixed::FromFloat(this->SpeedMax));
+}
+
+void GameLevel::BuildGrid(float width, float height)
+{
+	// cells of two ball diameters, as for the moving objects
+	this->ObstacleGrid.Init(glm::vec2(width, height), 4.0f * this->BallRadius);
+	for (unsigned int i = 0; i < this->Obstacles.size(); ++i)
+		this->ObstacleGrid.Insert(i, this->Obstacles[i].Position, this->Obstacles[i].Position + this->Obstacles[i].Size);
+	this->ObstacleGrid.Build();
+}
+
+bool GameLevel::LoadList(const char *file, std::vector<GameLevel> &levels)
 {
-	Ball1 = new BallObject(ball1Pos, ball_radius, initial_ball_velocity, ResourceManager::GetTexture("ball"));
-	Ball2 = new BallObject(ball2Pos, ball_radius, initial_ball_velocity, ResourceManager::GetTexture("ball"));
+	std::ifstream in(file);
+	if (!in)
+	{
+		std::cout << "ERROR::LEVEL: Failed to open level list " << file << std::endl;
+		return false;
+	}
+	std::string directory(file);
+	directory = directory.substr(0, directory.find_last_of("/\\") + 1);
+	std::vector<GameLevel> loaded;
+	std::string line;
+	while (std::getline(in, line))
+	{
+		std::istringstream values(line.substr(0, line.find('#')));
+		std::string name;
+		if (!(values >> name))
+			continue;
+		loaded.push_back(GameLevel());
+		if (!loaded.back().Load((directory + name).c_str()))
+			return false;
+	}
+	if (loaded.empty())
+	{
+		std::cout << "ERROR::LEVEL: " << file << " lists no levels" << std::endl;
+		return false;
+	}
+	levels.swap(loaded);
+	return true;
 }
 
-BallObject *GameLevel::getBall1()
+bool GameLevel::LoadPack(const char *file, std::vector<GameLevel> &levels)
 {
-	return Ball1;
+	FILE *in = fopen(file, "rb");
+	if (!in)
+		return false;
+	// the whole pack comes in with one read, then the records are copied out of it
+	fseek(in, 0, SEEK_END);
+	long size = ftell(in);
+	fseek(in, 0, SEEK_SET);
+	std::vector<char> data(size > 0 ? size : 0);
+	bool read = size > 0 && fread(data.data(), 1, data.size(), in) == data.size();
+	fclose(in);
+	PackHeader header;
+	bool valid = read && data.size() >= sizeof(header);
+	if (valid)
+	{
+		memcpy(&header, data.data(), sizeof(header));
+		valid = memcmp(header.Magic, PACK_MAGIC, sizeof(PACK_MAGIC)) == 0 && header.Version == PACK_VERSION && header.LevelCount > 0
+			&& data.size() == sizeof(header) + header.LevelCount * sizeof(PackLevel) + header.ObstacleCount * sizeof(PackObstacle);
+	}
+	if (!valid)
+	{
+		std::cout << "ERROR::LEVEL: " << file << " is not a level pack of this version" << std::endl;
+		return false;
+	}
+	const char *records = data.data() + sizeof(header);
+	const char *obstacles = records + header.LevelCount * sizeof(PackLevel);
+	std::vector<GameLevel> loaded(header.LevelCount);
+	for (unsigned int i = 0; i < header.LevelCount; ++i)
+	{
+		PackLevel record;
+		memcpy(&record, records + i * sizeof(PackLevel), sizeof(record));
+		if (record.FirstObstacle > header.ObstacleCount || record.ObstacleCount > header.ObstacleCount - record.FirstObstacle)
+		{
+			std::cout << "ERROR::LEVEL: " << file << " is damaged" << std::endl;
+			return false;
+		}
+		GameLevel &level = loaded[i];
+		level.Name.assign(record.Name, strnlen(record.Name, sizeof(record.Name)));
+		level.BallRadius = record.BallRadius;
+		level.SpeedStart = record.SpeedStart;
+		level.SpeedPerHit = record.SpeedPerHit;
+		level.SpeedMax = record.SpeedMax;
+		level.PaddleSize = glm::vec2(record.PaddleWidth, record.PaddleHeight);
+		for (unsigned int k = 0; k < record.ObstacleCount; ++k)
+		{
+			PackObstacle obstacle;
+			memcpy(&obstacle, obstacles + (record.FirstObstacle + k) * sizeof(PackObstacle), sizeof(obstacle));
+			Transform transform = { glm::vec2(obstacle.X, obstacle.Y), glm::vec2(obstacle.Width, obstacle.Height), 0.0f };
+			level.Obstacles.push_back(transform);
+		}
+	}
+	levels.swap(loaded);
+	return true;
 }
 
-BallObject *GameLevel::getBall2()
+bool GameLevel::SavePack(const char *file, const std::vector<GameLevel> &levels)
 {
-	return Ball2;
+	PackHeader header;
+	memcpy(header.Magic, PACK_MAGIC, sizeof(PACK_MAGIC));
+	header.Version = PACK_VERSION;
+	header.LevelCount = static_cast<unsigned int>(levels.size());
+	header.ObstacleCount = 0;
+	std::vector<PackLevel> records;
+	std::vector<PackObstacle> obstacles;
+	for (const GameLevel &level : levels)
+	{
+		PackLevel record;
+		memset(&record, 0, sizeof(record));
+		strncpy(record.Name, level.Name.c_str(), sizeof(record.Name) - 1);
+		record.BallRadius = level.BallRadius;
+		record.SpeedStart = level.SpeedStart;
+		record.SpeedPerHit = level.SpeedPerHit;
+		record.SpeedMax = level.SpeedMax;
+		record.PaddleWidth = level.PaddleSize.x;
+		record.PaddleHeight = level.PaddleSize.y;
+		record.FirstObstacle = static_cast<unsigned int>(obstacles.size());
+		record.ObstacleCount = static_cast<unsigned int>(level.Obstacles.size());
+		for (const Transform &obstacle : level.Obstacles)
+		{
+			PackObstacle packed = { obstacle.Position.x, obstacle.Position.y, obstacle.Size.x, obstacle.Size.y };
+			obstacles.push_back(packed);
+		}
+		records.push_back(record);
+	}
+	header.ObstacleCount = static_cast<unsigned int>(obstacles.size());
+	FILE *out = fopen(file, "wb");
+	if (!out)
+	{
+		std::cout << "ERROR::LEVEL: Failed to create " << file << std::endl;
+		return false;
+	}
+	bool written = fwrite(&header, sizeof(header), 1, out) == 1
+		&& fwrite(records.data(), sizeof(PackLevel), records.size(), out) == records.size()
+		&& fwrite(obstacles.data(), sizeof(PackObstacle), obstacles.size(), out) == obstacles.size();
+	if (fclose(out) != 0 || !written)
+	{
+		std::cout << "ERROR::LEVEL: Failed to write " << file << std::endl;
+		return false;
+	}
+	return true;
 }
@@ -1,27 +1,49 @@
 #ifndef GAMELEVEL_H
 #define GAMELEVEL_H
 
-#include "ball_object.h"
+#include <string>
+#include <vector>
 
-#include <glad/glad.h>
 #include <glm/glm.hpp>
 
-///GameLevel based of initial velocity of ball
+#include "entity_store.h"
+#include "uniform_grid.h"
+
+/// GameLevel describes one arena: how fast the ball gets, how large the
+/// paddles are and which obstacles stand in the playfield. Levels are
+/// written as text files (see levels/amateur.lvl) and compiled by
+/// pingpong_levelc into one binary pack that LoadPack reads with a single
+/// read; the text files are the fallback when no pack was built.
 class GameLevel
 {
 public:
-	// Balls for level
-	BallObject         *Ball1;
-	BallObject         *Ball2;
+	std::string        Name;
+	float              BallRadius;
+	// ball speed as a multiple of INITIAL_BALL_VELOCITY: SpeedStart at the serve,
+	// SpeedPerHit more after every paddle hit, up to SpeedMax
+	float              SpeedStart, SpeedPerHit, SpeedMax;
+	glm::vec2          PaddleSize;
+	// static rectangles the balls bounce off
+	std::vector<Transform> Obstacles;
+	// the obstacles bucketed by position, so a ball only tests the ones near it (see BuildGrid)
+	UniformGrid        ObstacleGrid;
 
 	// constructor
-	GameLevel() { }
-	// loads level from file
-	void Load(glm::vec2 ball1Pos, glm::vec2 ball2Pos, float ball_radius, glm::vec2 initial_ball_velocity);
+	GameLevel() : BallRadius(0.0f), SpeedStart(0.0f), SpeedPerHit(0.0f), SpeedMax(0.0f), PaddleSize(0.0f) { }
+	// loads level from file; returns false (and prints an error) on failure
+	bool  Load(const char *file);
+	// speed multiplier after hits paddle hits
+	float Speed(unsigned int hits) const;
+	// the same in fixed point, for the deterministic physics
+	Fixed FixedSpeed(unsigned int hits) const;
+	// buckets the obstacles of a width x height playfield into ObstacleGrid
+	void  BuildGrid(float width, float height);
 
-	// functions to return balls
-	BallObject *getBall1();
-	BallObject *getBall2();
+	// loads every level file named in a list file (one per line, relative to the list)
+	static bool LoadList(const char *file, std::vector<GameLevel> &levels);
+	// compiled level packs; LoadPack returns false without an error if the file does not exist
+	static bool LoadPack(const char *file, std::vector<GameLevel> &levels);
+	static bool SavePack(const char *file, const std::vector<GameLevel> &levels);
 };
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,72 @@
+#include "game_systems.h"
+
+void MoveSystem(EntityStore &entities, float dt, unsigned int height, bool reversed)
+{
+	for (unsigned int i = 0; i < entities.Kinematics.Size(); ++i)
+	{
+		Kinematic &body = entities.Kinematics.Dense[i];
+		if (body.Stuck)
+			continue;
+		Transform &transform = entities.Transforms.Get(entities.Kinematics.Entities[i]);
+		// move the entity
+		if (reversed) transform.Position -= body.Velocity * dt;
+		else transform.Position += body.Velocity * dt;
+		// check if outside window bounds; if so, reverse velocity and restore at correct position
+		if (transform.Position.y <= 0.0f)
+		{
+			body.Velocity.y = -body.Velocity.y;
+			transform.Position.y = 0.0f;
+		}
+		else if (transform.Position.y + transform.Size.y >= height)
+		{
+			body.Velocity.y = -body.Velocity.y;
+			transform.Position.y = height - transform.Size.y;
+		}
+	}
+}
+
+void FixedMoveSystem(EntityStore &entities, Fixed dt, Fixed height, bool reversed)
+{
+	for (unsigned int i = 0; i < entities.Kinematics.Size(); ++i)
+	{
+		if (entities.Kinematics.Dense[i].Stuck)
+			continue;
+		Entity entity = entities.Kinematics.Entities[i];
+		FixedBody &body = entities.FixedBodies.Get(entity);
+		Fixed size = Fixed::FromFloat(entities.Transforms.Get(entity).Size.y);
+		if (reversed) body.Position -= body.Velocity * dt;
+		else body.Position += body.Velocity * dt;
+		if (body.Position.y <= Fixed::FromInt(0))
+		{
+			body.Velocity.y = -body.Velocity.y;
+			body.Position.y = Fixed::FromInt(0);
+		}
+		else if (body.Position.y + size >= height)
+		{
+			body.Velocity.y = -body.Velocity.y;
+			body.Position.y = height - size;
+		}
+	}
+}
+
+void FixedSyncSystem(EntityStore &entities)
+{
+	for (unsigned int i = 0; i < entities.FixedBodies.Size(); ++i)
+	{
+		const FixedBody &body = entities.FixedBodies.Dense[i];
+		Entity entity = entities.FixedBodies.Entities[i];
+		entities.Transforms.Get(entity).Position = body.Position.ToFloat();
+		if (Kinematic *kinematic = entities.Kinematics.Find(entity))
+			kinematic->Velocity = body.Velocity.ToFloat();
+	}
+}
+
+void SpriteSystem(EntityStore &entities, SpriteRenderer &renderer)
+{
+	for (unsigned int i = 0; i < entities.Sprites.Size(); ++i)
+	{
+		const Sprite &sprite = entities.Sprites.Dense[i];
+		const Transform &transform = entities.Transforms.Get(entities.Sprites.Entities[i]);
+		renderer.DrawSprite(sprite.Texture, transform.Position, transform.Size, transform.Rotation, sprite.Color);
+	}
+}
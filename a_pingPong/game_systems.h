@@ -0,0 +1,21 @@
+#ifndef GAME_SYSTEMS_H
+#define GAME_SYSTEMS_H
+
+#include "entity_store.h"
+#include "sprite_renderer.h"
+
+
+// Systems run one kind of behaviour over every entity that has the
+// components it needs, walking the dense component arrays in order.
+
+// moves every entity with a Kinematic (and Transform) that is not stuck by its
+// velocity, against it if reversed, and bounces it off the top and bottom edge
+void MoveSystem(EntityStore &entities, float dt, unsigned int height, bool reversed);
+// MoveSystem in fixed point: moves the FixedBody of every Kinematic that is not stuck
+void FixedMoveSystem(EntityStore &entities, Fixed dt, Fixed height, bool reversed);
+// copies every FixedBody into the entity's Transform position and Kinematic velocity
+void FixedSyncSystem(EntityStore &entities);
+// draws every entity with a Sprite (and Transform), in the order the sprites were added
+void SpriteSystem(EntityStore &entities, SpriteRenderer &renderer);
+
+#endif
@@ -0,0 +1,115 @@
+#include "gpu_particle_generator.h"
+
+#include <vector>
+
+// per particle: vec2 position, vec2 velocity, vec4 color, float life
+static const unsigned int STATE_FLOATS = 9;
+
+const char *const GpuParticleGenerator::VARYINGS[4] = { "outPosition", "outVelocity", "outColor", "outLife" };
+
+GpuParticleGenerator::GpuParticleGenerator(Shader updateShader, Shader renderShader, Texture2D texture, unsigned int amount)
+	: amount(amount), spawnCursor(0), frame(0), current(0), updateShader(updateShader), renderShader(renderShader), texture(texture)
+{
+	this->init();
+}
+
+GpuParticleGenerator::~GpuParticleGenerator()
+{
+	glDeleteVertexArrays(2, this->updateVAO);
+	glDeleteVertexArrays(2, this->renderVAO);
+	glDeleteBuffers(2, this->stateVBO);
+	glDeleteBuffers(1, &this->quadVBO);
+}
+
+void GpuParticleGenerator::Update(float dt, glm::vec2 position, glm::vec2 velocity, unsigned int newParticles, glm::vec2 offset)
+{
+	if (newParticles > this->amount)
+		newParticles = this->amount;
+	this->updateShader.Use();
+	this->updateShader.SetFloat("dt", dt);
+	this->updateShader.SetInteger("amount", this->amount);
+	this->updateShader.SetInteger("spawnStart", this->spawnCursor);
+	this->updateShader.SetInteger("spawnCount", newParticles);
+	this->updateShader.SetInteger("seed", this->frame++);
+	this->updateShader.SetVector2f("emitterPosition", position + offset);
+	this->updateShader.SetVector2f("emitterVelocity", velocity);
+	this->spawnCursor = (this->spawnCursor + newParticles) % this->amount;
+	// run one vertex per particle, capturing the new state into the other buffer
+	unsigned int next = 1 - this->current;
+	glEnable(GL_RASTERIZER_DISCARD);
+	glBindVertexArray(this->updateVAO[this->current]);
+	glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, this->stateVBO[next]);
+	glBeginTransformFeedback(GL_POINTS);
+	glDrawArrays(GL_POINTS, 0, this->amount);
+	glEndTransformFeedback();
+	glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, 0);
+	glBindVertexArray(0);
+	glDisable(GL_RASTERIZER_DISCARD);
+	this->current = next;
+}
+
+void GpuParticleGenerator::Draw()
+{
+	// use additive blending to give it a 'glow' effect, and draw every slot; the shader clips dead ones
+	glBlendFunc(GL_SRC_ALPHA, GL_ONE);
+	this->renderShader.Use();
+	this->texture.Bind();
+	glBindVertexArray(this->renderVAO[this->current]);
+	glDrawArraysInstanced(GL_TRIANGLES, 0, 6, this->amount);
+	glBindVertexArray(0);
+	// don't forget to reset to default blending mode
+	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+}
+
+void GpuParticleGenerator::init()
+{
+	float particle_quad[] = {
+		0.0f, 1.0f, 0.0f, 1.0f,
+		1.0f, 0.0f, 1.0f, 0.0f,
+		0.0f, 0.0f, 0.0f, 0.0f,
+
+		0.0f, 1.0f, 0.0f, 1.0f,
+		1.0f, 1.0f, 1.0f, 1.0f,
+		1.0f, 0.0f, 1.0f, 0.0f
+	};
+	glGenBuffers(1, &this->quadVBO);
+	glBindBuffer(GL_ARRAY_BUFFER, this->quadVBO);
+	glBufferData(GL_ARRAY_BUFFER, sizeof(particle_quad), particle_quad, GL_STATIC_DRAW);
+	// both state buffers start out with every particle dead (all zeros)
+	std::vector<float> dead(this->amount * STATE_FLOATS, 0.0f);
+	glGenBuffers(2, this->stateVBO);
+	glGenVertexArrays(2, this->updateVAO);
+	glGenVertexArrays(2, this->renderVAO);
+	GLsizei stride = STATE_FLOATS * sizeof(float);
+	for (unsigned int i = 0; i < 2; ++i)
+	{
+		glBindBuffer(GL_ARRAY_BUFFER, this->stateVBO[i]);
+		glBufferData(GL_ARRAY_BUFFER, dead.size() * sizeof(float), dead.data(), GL_DYNAMIC_COPY);
+		// update: the state as vertex attributes, in the order of VARYINGS
+		glBindVertexArray(this->updateVAO[i]);
+		glEnableVertexAttribArray(0);
+		glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, stride, (void*)0);
+		glEnableVertexAttribArray(1);
+		glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, stride, (void*)(2 * sizeof(float)));
+		glEnableVertexAttribArray(2);
+		glVertexAttribPointer(2, 4, GL_FLOAT, GL_FALSE, stride, (void*)(4 * sizeof(float)));
+		glEnableVertexAttribArray(3);
+		glVertexAttribPointer(3, 1, GL_FLOAT, GL_FALSE, stride, (void*)(8 * sizeof(float)));
+		// render: the quad per vertex, position/color/life per instance
+		glBindVertexArray(this->renderVAO[i]);
+		glEnableVertexAttribArray(1);
+		glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, stride, (void*)0);
+		glVertexAttribDivisor(1, 1);
+		glEnableVertexAttribArray(2);
+		glVertexAttribPointer(2, 4, GL_FLOAT, GL_FALSE, stride, (void*)(4 * sizeof(float)));
+		glVertexAttribDivisor(2, 1);
+		glEnableVertexAttribArray(3);
+		glVertexAttribPointer(3, 1, GL_FLOAT, GL_FALSE, stride, (void*)(8 * sizeof(float)));
+		glVertexAttribDivisor(3, 1);
+		glBindBuffer(GL_ARRAY_BUFFER, this->quadVBO);
+		glEnableVertexAttribArray(0);
+		glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)0);
+	}
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	glBindVertexArray(0);
+}
@@ -0,0 +1,48 @@
+#ifndef GPU_PARTICLE_GENERATOR_H
+#define GPU_PARTICLE_GENERATOR_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "shader.h"
+#include "texture.h"
+
+
+// GpuParticleGenerator is the GPU counterpart of ParticleGenerator: the
+// particle state lives in two buffer objects and a vertex shader advances
+// it from one into the other with transform feedback, so the CPU only
+// uploads the emitter parameters and the spawn batch of each frame. Spawns
+// reuse the slots round-robin (with a fixed life time that is always the
+// oldest particle), which keeps it practical for 100k+ particle trails.
+class GpuParticleGenerator
+{
+public:
+	// constructor/destructor; needs the "particle_update" and "particle_gpu" shaders
+	GpuParticleGenerator(Shader updateShader, Shader renderShader, Texture2D texture, unsigned int amount);
+	~GpuParticleGenerator();
+	// respawns newParticles particles at the emitter position and velocity and advances all of them by dt
+	void Update(float dt, glm::vec2 position, glm::vec2 velocity, unsigned int newParticles, glm::vec2 offset = glm::vec2(0.0f, 0.0f));
+	// render all particles
+	void Draw();
+	// names of the update shader outputs, in state buffer order
+	static const char *const VARYINGS[4];
+private:
+	// state
+	unsigned int amount;
+	unsigned int spawnCursor;
+	unsigned int frame;
+	// index of the buffer holding the latest state; Update writes the other one
+	unsigned int current;
+	// render state
+	Shader updateShader;
+	Shader renderShader;
+	Texture2D texture;
+	unsigned int quadVBO;
+	unsigned int stateVBO[2];
+	// updateVAO[i] reads stateVBO[i] as vertices, renderVAO[i] reads it as instances
+	unsigned int updateVAO[2], renderVAO[2];
+	// initializes buffers and vertex attributes
+	void init();
+};
+
+#endif
@@ -0,0 +1,497 @@
+#include <glad/glad.h>
+
+#include "allocation_tracker.h"
+#include "audio_engine.h"
+#include "batch_sim.h"
+#include "frame_capture.h"
+#include "game.h"
+#include "input_queue.h"
+#include "job_system.h"
+#include "latency_probe.h"
+#include "offscreen_context.h"
+#include "profiler.h"
+#include "quality_governor.h"
+#include "replay.h"
+#include "resource_manager.h"
+#include "state_hash.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+#ifdef _WIN32
+#include <direct.h>
+#define chdir _chdir
+#else
+#include <unistd.h>
+#endif
+
+// Headless driver: runs the game with the autopilot at a fixed time step,
+// either rendering every frame into an offscreen context (EGL/OSMesa) or,
+// with --sim-only, without any OpenGL at all. Intended for CI runners and
+// render farms without a GPU or display. With --replay it re-simulates a
+// recorded match instead, and --capture encodes it to a video as fast as
+// the renderer allows. --batch N plays N matches at once on the batch
+// simulator for --frames ticks of --dt seconds each instead.
+// --state-log writes the state of every tick and --state-check stops at the
+// first tick that differs from such a log, printing the fields that differ;
+// --state-diff compares two logs, e.g. from two peers or builds.
+// --latency N presses player 1's keys N times instead of the autopilot and
+// reads every frame back to measure how long each press takes to show.
+// --audio mixes the game's sound in step with the simulated time, into
+// memory, and checks that every effect started within a mixer period.
+
+// The Width of the screen
+const unsigned int SCREEN_WIDTH = 900;
+// The height of the screen
+const unsigned int SCREEN_HEIGHT = 600;
+
+// paddle hits and points so far; both trigger a sound effect when they go up
+static unsigned int soundEvents(const Game &game)
+{
+	unsigned int events = 0;
+	for (const Kinematic &kinematic : game.Entities.Kinematics.Dense)
+		events += kinematic.Hits;
+	for (const Score &score : game.Entities.Scores.Dense)
+		events += score.Points;
+	return events;
+}
+
+// reports what the mixer made of the run's sound effects; false if an effect did not load, was
+// lost or late, none was triggered for the run's hits and points, or the mix does not cover the run
+static bool checkAudio(const Game &game, BufferAudioOutput &output, unsigned long long framesMixed, unsigned long long events)
+{
+	const AudioStats &stats = *game.AudioStatistics();
+	std::vector<short> samples = output.Captured();
+	int peak = 0;
+	unsigned long long clipped = 0;
+	for (short sample : samples)
+	{
+		int level = sample < 0 ? -sample : sample;
+		peak = std::max(peak, level);
+		clipped += level >= 32767;
+	}
+	std::cout << "audio: " << stats.Triggered << " effects triggered, " << stats.Started << " started ("
+		<< stats.Stolen << " stolen, " << stats.Dropped << " dropped), trigger latency at most "
+		<< stats.MaxTriggerFrames * 1000.0 / AudioEngine::SAMPLE_RATE << " ms; " << samples.size() / AudioEngine::CHANNELS
+		<< " frames mixed, peak " << peak << ", " << clipped << " clipped samples" << std::endl;
+	bool ok = true;
+	if (stats.Unloaded > 0 || stats.Missing > 0)
+	{
+		std::cout << "ERROR::HEADLESS: " << stats.Unloaded << " sound effects did not load (is the decoder for their format built in?)" << std::endl;
+		ok = false;
+	}
+	else if (events > 0 && stats.Triggered == 0)
+	{
+		std::cout << "ERROR::HEADLESS: " << events << " hits and points triggered no sound effect" << std::endl;
+		ok = false;
+	}
+	if (stats.Dropped > 0 || stats.Started != stats.Triggered)
+	{
+		std::cout << "ERROR::HEADLESS: " << stats.Triggered + stats.Dropped - stats.Started << " sound effects never started" << std::endl;
+		ok = false;
+	}
+	if (stats.MaxTriggerFrames > AudioEngine::PERIOD_FRAMES)
+	{
+		std::cout << "ERROR::HEADLESS: a sound effect waited more than one mixer period" << std::endl;
+		ok = false;
+	}
+	if (samples.size() != framesMixed * AudioEngine::CHANNELS || (stats.Started > 0 && peak == 0))
+	{
+		std::cout << "ERROR::HEADLESS: the mixed audio is incomplete or silent" << std::endl;
+		ok = false;
+	}
+	return ok;
+}
+
+// plays the matches on the batch simulator with the rules of the level and reports the results
+static int runBatch(Game &game, unsigned int matches, unsigned int ticks, float deltaTime, unsigned int level, bool generic)
+{
+	game.InitSimulation();
+	const GameLevel &selected = game.Levels[std::min(level, static_cast<unsigned int>(game.Levels.size()) - 1)];
+	BatchRules batchRules = { selected.SpeedStart, static_cast<unsigned int>(1.0f / deltaTime + 0.5f),
+		static_cast<float>(SCREEN_WIDTH), static_cast<float>(SCREEN_HEIGHT), selected.BallRadius, selected.PaddleSize.x, selected.PaddleSize.y };
+	BatchSimulator simulator(matches, batchRules, generic);
+	auto start = std::chrono::steady_clock::now();
+	simulator.Step(ticks);
+	std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+	JobSystem::Stop();
+	unsigned long long wins1 = 0, wins2 = 0, hits = 0;
+	for (unsigned int i = 0; i < matches; ++i)
+	{
+		wins1 += simulator.Wins1[i];
+		wins2 += simulator.Wins2[i];
+		hits += simulator.Hits[i];
+	}
+	std::cout << matches << " matches x " << ticks << " ticks at " << batchRules.TickRate << " Hz on the "
+		<< (simulator.Specialized() ? "specialized" : "generic") << " kernel in " << elapsed.count() << " ms ("
+		<< elapsed.count() * 1.0e6 / (static_cast<double>(matches) * ticks) << " ns/match-tick)" << std::endl;
+	std::cout << "games won: player 1 " << wins1 << ", player 2 " << wins2 << "; " << hits << " paddle hits" << std::endl;
+	return 0;
+}
+
+int main(int argc, char *argv[])
+{
+	// command line options
+	// --------------------
+	unsigned int frames = 600;
+	float deltaTime = 1.0f / 60.0f;
+	bool simOnly = false;
+	const char *screenshot = nullptr;
+	const char *replayFile = nullptr;
+	const char *captureFile = nullptr;
+	const char *traceFile = nullptr;
+	bool checkAllocations = false;
+	unsigned int fps = 60;
+	unsigned int particles = 500;
+	unsigned int gpuParticles = 0;
+	unsigned int balls = 1;
+	unsigned int level = 0;
+	unsigned int threads = 0;
+	unsigned int batch = 0;
+	bool generic = false;
+	bool fixedPoint = false;
+	const char *stateLogFile = nullptr;
+	const char *stateCheckFile = nullptr;
+	unsigned int latencyPresses = 0;
+	bool audio = false;
+	float resolutionScale = 1.0f;
+	bool dynamicResolution = false;
+	float qualityBudget = 0.0f;
+	for (int i = 1; i < argc; ++i)
+	{
+		if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc)
+			frames = static_cast<unsigned int>(atoi(argv[++i]));
+		else if (strcmp(argv[i], "--dt") == 0 && i + 1 < argc)
+			deltaTime = static_cast<float>(atof(argv[++i]));
+		else if (strcmp(argv[i], "--sim-only") == 0)
+			simOnly = true;
+		else if (strcmp(argv[i], "--screenshot") == 0 && i + 1 < argc)
+			screenshot = argv[++i];
+		else if (strcmp(argv[i], "--replay") == 0 && i + 1 < argc)
+			replayFile = argv[++i];
+		else if (strcmp(argv[i], "--capture") == 0 && i + 1 < argc)
+			captureFile = argv[++i];
+		else if (strcmp(argv[i], "--trace") == 0 && i + 1 < argc)
+			traceFile = argv[++i];
+		else if (strcmp(argv[i], "--check-allocations") == 0)
+			checkAllocations = true;
+		else if (strcmp(argv[i], "--fps") == 0 && i + 1 < argc)
+			fps = static_cast<unsigned int>(atoi(argv[++i]));
+		else if (strcmp(argv[i], "--particles") == 0 && i + 1 < argc)
+			particles = static_cast<unsigned int>(atoi(argv[++i]));
+		else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc)
+			threads = static_cast<unsigned int>(atoi(argv[++i]));
+		else if (strcmp(argv[i], "--gpu-particles") == 0 && i + 1 < argc)
+			gpuParticles = static_cast<unsigned int>(atoi(argv[++i]));
+		else if (strcmp(argv[i], "--balls") == 0 && i + 1 < argc)
+			balls = std::max(1, atoi(argv[++i]));
+		else if (strcmp(argv[i], "--level") == 0 && i + 1 < argc)
+			level = static_cast<unsigned int>(atoi(argv[++i]));
+		else if (strcmp(argv[i], "--batch") == 0 && i + 1 < argc)
+			batch = static_cast<unsigned int>(atoi(argv[++i]));
+		else if (strcmp(argv[i], "--generic") == 0)
+			generic = true;
+		else if (strcmp(argv[i], "--fixed-point") == 0)
+			fixedPoint = true;
+		else if (strcmp(argv[i], "--state-log") == 0 && i + 1 < argc)
+			stateLogFile = argv[++i];
+		else if (strcmp(argv[i], "--state-check") == 0 && i + 1 < argc)
+			stateCheckFile = argv[++i];
+		else if (strcmp(argv[i], "--resolution-scale") == 0 && i + 1 < argc)
+			resolutionScale = static_cast<float>(atof(argv[++i]));
+		else if (strcmp(argv[i], "--dynamic-resolution") == 0)
+			dynamicResolution = true;
+		else if (strcmp(argv[i], "--quality-budget") == 0 && i + 1 < argc)
+			qualityBudget = static_cast<float>(atof(argv[++i]));
+		else if (strcmp(argv[i], "--audio") == 0)
+			audio = true;
+		else if (strcmp(argv[i], "--latency") == 0 && i + 1 < argc)
+			latencyPresses = static_cast<unsigned int>(atoi(argv[++i]));
+		else if (strcmp(argv[i], "--state-diff") == 0 && i + 2 < argc)
+		{
+			i += 2;
+			return StateLog::Compare(argv[i - 1], argv[i]) ? 0 : 1;
+		}
+		else if (strcmp(argv[i], "--data") == 0 && i + 1 < argc)
+		{
+			// shaders, textures and fonts are loaded relative to the working directory
+			if (chdir(argv[++i]) != 0)
+			{
+				std::cout << "ERROR::HEADLESS: Cannot change to data directory " << argv[i] << std::endl;
+				return -1;
+			}
+		}
+		else
+		{
+			std::cout << "usage: " << argv[0] << " [--frames N] [--dt seconds] [--sim-only] [--screenshot file.ppm] [--data dir]"
+				<< " [--replay file] [--capture out.y4m|out_%05d.png] [--fps N] [--trace file.json] [--check-allocations]"
+				<< " [--particles N] [--gpu-particles N] [--threads N] [--balls N] [--level N]"
+				<< " [--batch N [--generic]] [--fixed-point]"
+				<< " [--state-log file] [--state-check file] [--state-diff fileA fileB] [--latency N]"
+				<< " [--resolution-scale S] [--dynamic-resolution] [--quality-budget ms] [--audio]" << std::endl;
+			return -1;
+		}
+	}
+
+	Replay replay;
+	StateLog stateLog, stateCheck;
+	if ((stateLogFile && !stateLog.Open(stateLogFile)) || (stateCheckFile && !stateCheck.Load(stateCheckFile)))
+		return -1;
+	if (replayFile)
+	{
+		if (!replay.Load(replayFile))
+			return -1;
+		frames = static_cast<unsigned int>(replay.Frames.size());
+		// particles are randomized; reuse the recorded seed so the video matches the match
+		srand(replay.Seed);
+		fixedPoint = fixedPoint || replay.FixedPoint;
+		// the match only replays with the balls it was recorded with
+		balls = replay.BallCount;
+	}
+	if (checkAllocations && !AllocationTracker::Enabled())
+	{
+		std::cout << "ERROR::HEADLESS: --check-allocations needs a build with PINGPONG_TRACK_ALLOCATIONS" << std::endl;
+		return -1;
+	}
+	if (latencyPresses && (simOnly || replayFile))
+	{
+		std::cout << "ERROR::HEADLESS: --latency needs rendering and no --replay" << std::endl;
+		return -1;
+	}
+	if (audio && simOnly)
+	{
+		std::cout << "ERROR::HEADLESS: --audio needs rendering" << std::endl;
+		return -1;
+	}
+	if (captureFile && (simOnly || fps == 0))
+	{
+		std::cout << "ERROR::HEADLESS: --capture needs rendering and a positive --fps" << std::endl;
+		return -1;
+	}
+
+	// the context must outlive the game, whose destructor releases GL objects
+	OffscreenContext context;
+	FrameCapture capture;
+	Game PingPong(SCREEN_WIDTH, SCREEN_HEIGHT);
+	// headless runs never open a sound device; --audio mixes in the game loop below
+	PingPong.AudioEnabled = audio;
+	PingPong.ManualAudio = true;
+	PingPong.ParticleCount = particles;
+	PingPong.GpuParticleCount = gpuParticles;
+	PingPong.BallCount = balls;
+	PingPong.FixedPoint = fixedPoint;
+	PingPong.ResolutionScale = resolutionScale;
+	PingPong.DynamicResolution = dynamicResolution;
+	PingPong.QualityBudget = qualityBudget;
+	// --threads counts this thread too; 1 runs everything here
+	if (threads != 1)
+		JobSystem::Start(threads > 1 ? threads - 1 : 0);
+	if (batch > 0)
+		return runBatch(PingPong, batch, frames, deltaTime, level, generic);
+	if (simOnly)
+		PingPong.InitSimulation();
+	else
+	{
+		if (!context.Create(SCREEN_WIDTH, SCREEN_HEIGHT))
+		{
+			JobSystem::Stop();
+			return -1;
+		}
+		std::cout << "Renderer: " << glGetString(GL_RENDERER) << std::endl;
+		// OpenGL configuration
+		// --------------------
+		glViewport(0, 0, SCREEN_WIDTH, SCREEN_HEIGHT);
+		glEnable(GL_BLEND);
+		glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+		PingPong.Init();
+		if (captureFile && !capture.Open(captureFile, SCREEN_WIDTH, SCREEN_HEIGHT, fps))
+		{
+			JobSystem::Stop();
+			return -1;
+		}
+	}
+	// the autopilot never touches the menu's level selection
+	PingPong.SelectLevel(level);
+	// synthetic presses go through the game's input path: the queue, a tick, a frame
+	InputQueue input;
+	LatencyProbe latency;
+	std::vector<unsigned char> column, lastColumn;
+	int heldKey = 0;
+	unsigned int idleFrames = 0;
+	if (latencyPresses)
+	{
+		// presses at most every few frames; the frame limit only guards against a stuck probe
+		frames = latencyPresses * 16;
+		PingPong.State = GAME_ACTIVE;
+	}
+
+	// --audio: the mix of the whole run, written unpaced
+	double duration = frames * static_cast<double>(deltaTime);
+	if (replayFile)
+	{
+		duration = 0.0;
+		for (const ReplayFrame &recorded : replay.Frames)
+			duration += recorded.Dt;
+	}
+	BufferAudioOutput audioOutput(audio ? static_cast<unsigned int>(duration * AudioEngine::SAMPLE_RATE) + AudioEngine::PERIOD_FRAMES : 0, false);
+	audioOutput.Open(AudioEngine::SAMPLE_RATE, AudioEngine::CHANNELS, AudioEngine::PERIOD_FRAMES);
+	std::vector<short> audioPeriod(AudioEngine::PERIOD_FRAMES * AudioEngine::CHANNELS);
+	unsigned long long audioFrames = 0, audioEvents = 0;
+
+#ifdef PINGPONG_PROFILE
+	Profiler::Start(traceFile, !simOnly);
+#endif
+
+	// fixed-step game loop
+	// --------------------
+	// the video runs at a constant frame rate while replays have the variable
+	// time steps they were recorded with: a video frame shows the latest state
+	// at its timestamp, and frames no video frame falls on are not rendered
+	// the first video frame is the state after the first tick; later timestamps are counted from it
+	// (not summed) and compared with some slack, as the tick lengths are rounded floats
+	double simTime = 0.0, videoStart = 0.0;
+	unsigned long long videoFrames = 0;
+	const double VIDEO_SLACK = 1.0e-4;
+	// steady state starts once the first frames have warmed up lazily created state
+	const unsigned int warmupFrames = 60;
+	unsigned long long maxAllocations = 0, allocatingFrames = 0;
+	bool desync = false;
+	auto start = std::chrono::steady_clock::now();
+	for (unsigned int frame = 0; frame < frames; ++frame)
+	{
+		PROFILE_FRAME();
+		unsigned long long allocations = AllocationTracker::ThreadAllocations();
+		if (replayFile)
+		{
+			Replay::Apply(PingPong, replay.Frames[frame]);
+			deltaTime = replay.Frames[frame].Dt;
+		}
+		else if (latencyPresses)
+		{
+			// release the key once its press showed, then after a pause press the other direction
+			double now = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+			if (!latency.Busy() && heldKey)
+			{
+				InputEvent release = { now, heldKey, false };
+				input.Push(release);
+				heldKey = 0;
+				idleFrames = 0;
+			}
+			else if (!latency.Busy() && ++idleFrames > 2)
+			{
+				heldKey = latency.Samples.size() % 2 ? GLFW_KEY_DOWN : GLFW_KEY_UP;
+				InputEvent press = { now, heldKey, true };
+				input.Push(press);
+				latency.Input(heldKey, now);
+			}
+			input.Apply(PingPong, now);
+		}
+		else
+			PingPong.Autopilot();
+		PingPong.ProcessInput(deltaTime);
+		unsigned int events = audio ? soundEvents(PingPong) : 0;
+		PingPong.Update(deltaTime);
+		// a serve resets the hits and a new match the points, so only count what went up
+		if (audio && soundEvents(PingPong) > events)
+			audioEvents += soundEvents(PingPong) - events;
+		simTime += deltaTime;
+		if (frame == 0)
+			videoStart = simTime;
+		double videoTime = videoStart + videoFrames / static_cast<double>(fps);
+		// mix whole periods up to the simulated time, as the mixer thread would in real time
+		while (audio && (audioFrames + AudioEngine::PERIOD_FRAMES) <= simTime * AudioEngine::SAMPLE_RATE)
+		{
+			PingPong.MixAudio(audioPeriod.data(), AudioEngine::PERIOD_FRAMES);
+			audioOutput.Write(audioPeriod.data(), AudioEngine::PERIOD_FRAMES);
+			audioFrames += AudioEngine::PERIOD_FRAMES;
+		}
+		if (latencyPresses)
+			latency.Simulated(PingPong, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+		if (stateLogFile)
+			stateLog.Record(PingPong);
+		if (stateCheckFile && !stateCheck.Check(frame, PingPong))
+		{
+			desync = true;
+			frames = frame + 1;
+		}
+		if (!simOnly && (!captureFile || videoTime <= simTime + VIDEO_SLACK))
+		{
+			glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+			glClear(GL_COLOR_BUFFER_BIT);
+			PingPong.Render();
+			if (latencyPresses)
+				latency.Rendered(std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+			// stands in for SwapBuffers, which hands each frame to the driver
+			glFlush();
+			if (latencyPresses)
+			{
+				// the press has shown once player 1's paddle column changes
+				latency.Presented(std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+				const GameLevel &current = PingPong.Levels[PingPong.Level];
+				GLint x = static_cast<GLint>(SCREEN_WIDTH - 5.0f - current.PaddleSize.x / 2.0f);
+				column.resize(SCREEN_HEIGHT * 4);
+				glReadPixels(x, 0, 1, SCREEN_HEIGHT, GL_RGBA, GL_UNSIGNED_BYTE, column.data());
+				if (!lastColumn.empty() && column != lastColumn)
+					latency.Displayed(std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+				column.swap(lastColumn);
+				if (latency.Samples.size() >= latencyPresses)
+					frames = frame + 1;
+			}
+			for (; captureFile && videoTime <= simTime + VIDEO_SLACK; videoTime = videoStart + ++videoFrames / static_cast<double>(fps))
+				capture.Capture();
+		}
+		allocations = AllocationTracker::ThreadAllocations() - allocations;
+		if (frame >= warmupFrames && allocations > 0)
+		{
+			maxAllocations = std::max(maxAllocations, allocations);
+			++allocatingFrames;
+		}
+	}
+	if (captureFile)
+	{
+		capture.Close();
+		std::cout << "Captured " << capture.FramesWritten << " frames to " << captureFile << std::endl;
+	}
+	if (!simOnly)
+		glFinish();
+	std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+	std::cout << frames << " frames in " << elapsed.count() << " ms ("
+		<< elapsed.count() / frames << " ms/frame)" << std::endl;
+	if (qualityBudget > 0.0f && !simOnly)
+		std::cout << "quality " << QualityGovernor::TIERS[PingPong.QualityTier].Name << std::endl;
+	else if (dynamicResolution && !simOnly)
+		std::cout << "resolution scale " << PingPong.ResolutionScale << std::endl;
+#ifdef PINGPONG_PROFILE
+	Profiler::Stop();
+	FrameStats stats = Profiler::Stats();
+	std::cout << "frame p50 " << stats.P50 << " ms, p99 " << stats.P99 << " ms; gpu p50 "
+		<< stats.GpuP50 << " ms, p99 " << stats.GpuP99 << " ms" << std::endl;
+#endif
+
+	if (screenshot && !simOnly)
+	{
+		std::vector<unsigned char> pixels;
+		context.ReadPixels(pixels);
+		WritePPM(screenshot, pixels, context.Width, context.Height);
+	}
+
+	JobSystem::Stop();
+	stateLog.Close();
+	std::cout << (fixedPoint ? "fixed-point state " : "state ") << std::hex << StateHash(PingPong) << std::dec << std::endl;
+	if (latencyPresses)
+		latency.Report();
+	bool audioFailed = audio && !checkAudio(PingPong, audioOutput, audioFrames, audioEvents);
+	if (checkAllocations)
+		std::cout << allocatingFrames << " steady-state frames allocated (at most " << maxAllocations
+			<< " allocations per frame)" << std::endl;
+
+	// delete all resources as loaded using the resource manager
+	// ---------------------------------------------------------
+	if (!simOnly)
+		ResourceManager::Clear();
+	return desync || audioFailed || (checkAllocations && allocatingFrames > 0) ? 1 : 0;
+}
@@ -0,0 +1,49 @@
+#include "input_queue.h"
+
+#include <algorithm>
+
+#include "game.h"
+#include "replay.h"
+
+// presses a single tick keeps track of; more keys than this pressed within one tick apply without holding
+const unsigned int MAX_TICK_PRESSES = 16;
+
+void InputQueue::Push(const InputEvent &event)
+{
+	if (!this->events.Push(event))
+		++this->Dropped;
+}
+
+unsigned short InputQueue::Apply(Game &game, double time)
+{
+	unsigned short released = 0;
+	int pressed[MAX_TICK_PRESSES];
+	unsigned int presses = 0;
+	while (this->hasPending || this->events.Pop(this->pending))
+	{
+		this->hasPending = true;
+		const InputEvent &event = this->pending;
+		if (event.Time > time)
+			break;
+		// a release of a key pressed in this tick waits for the next one, and so do the events after it
+		if (!event.Pressed && std::find(pressed, pressed + presses, event.Key) != pressed + presses)
+			break;
+		if (event.Key >= 0 && event.Key < 1024)
+		{
+			if (event.Pressed)
+			{
+				game.Keys[event.Key] = true;
+				if (presses < MAX_TICK_PRESSES)
+					pressed[presses++] = event.Key;
+			}
+			else
+			{
+				game.Keys[event.Key] = false;
+				game.KeysProcessed[event.Key] = false;
+				released |= Replay::KeyBit(event.Key);
+			}
+		}
+		this->hasPending = false;
+	}
+	return released;
+}
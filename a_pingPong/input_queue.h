@@ -0,0 +1,42 @@
+#ifndef INPUT_QUEUE_H
+#define INPUT_QUEUE_H
+
+#include "spsc_queue.h"
+
+class Game;
+
+// A key press or release, stamped with the time (glfwGetTime) it happened at
+struct InputEvent {
+	double Time;
+	int    Key;
+	bool   Pressed;
+};
+
+
+// InputQueue carries key events from the window's key callback (the
+// producer) to the fixed-step simulation (the consumer) on a lock-free
+// ring. Each tick applies the events that happened before its end to the
+// game's key state, so input lands on the tick it belongs to whatever the
+// frame rate. A key pressed and released within one tick stays held for
+// that tick and is released on the next one, so ProcessInput sees every
+// press, however short.
+class InputQueue
+{
+public:
+	// events dropped because the ring was full
+	unsigned int Dropped;
+	// constructor
+	InputQueue() : Dropped(0), hasPending(false) { }
+	// queues an event (producer thread only)
+	void Push(const InputEvent &event);
+	// applies the events up to time to the game's Keys/KeysProcessed (consumer thread only);
+	// returns the replay bits (Replay::KeyBit) of the keys it released
+	unsigned short Apply(Game &game, double time);
+private:
+	SpscQueue<InputEvent, 256> events;
+	// the first event not yet applied, already taken off the ring
+	InputEvent                 pending;
+	bool                       hasPending;
+};
+
+#endif
@@ -0,0 +1,197 @@
+#include "job_system.h"
+
+// Instantiate static variables
+std::unique_ptr<JobSystem::WorkQueue[]>   JobSystem::queues;
+std::vector<std::thread>                  JobSystem::workers;
+std::atomic<bool>                         JobSystem::running(false);
+std::atomic<unsigned int>                 JobSystem::pending(0);
+std::mutex                                JobSystem::sleepLock;
+std::condition_variable                   JobSystem::wake;
+unsigned int                              JobSystem::queueCount = 0;
+
+// deque owned by the current thread: 0 for the thread that called Start, 1.. for the workers
+static thread_local unsigned int queueIndex = 0;
+// counter of the job running on the current thread, which its children are added to
+static thread_local JobCounter  *currentCounter = nullptr;
+
+void JobSystem::Start(unsigned int workerCount)
+{
+	if (running)
+		return;
+	if (workerCount == 0)
+	{
+		unsigned int threads = std::thread::hardware_concurrency();
+		workerCount = threads > 1 ? threads - 1 : 0;
+	}
+	queueCount = workerCount + 1;
+	queues.reset(new WorkQueue[queueCount]);
+	for (unsigned int i = 0; i < queueCount; ++i)
+		queues[i].Head = queues[i].Tail = 0;
+	queueIndex = 0;
+	running = true;
+	for (unsigned int i = 1; i < queueCount; ++i)
+		workers.push_back(std::thread(workerLoop, i));
+}
+
+void JobSystem::Stop()
+{
+	if (!running)
+		return;
+	{
+		std::lock_guard<std::mutex> lock(sleepLock);
+		running = false;
+	}
+	wake.notify_all();
+	for (std::thread &worker : workers)
+		worker.join();
+	workers.clear();
+	queues.reset();
+	queueCount = 0;
+}
+
+unsigned int JobSystem::WorkerCount()
+{
+	return static_cast<unsigned int>(workers.size());
+}
+
+void JobSystem::Run(void (*function)(void*, unsigned int, unsigned int), void *context,
+	unsigned int begin, unsigned int end, JobCounter &counter)
+{
+	Job job = { function, context, begin, end, &counter };
+	counter.Pending.fetch_add(1);
+	if (!running || queueCount < 2)
+	{
+		run(job);
+		return;
+	}
+	push(job);
+	notify();
+}
+
+void JobSystem::RunChild(void (*function)(void*, unsigned int, unsigned int), void *context,
+	unsigned int begin, unsigned int end)
+{
+	if (!currentCounter)
+	{
+		function(context, begin, end);
+		return;
+	}
+	// the parent is still running, so its counter cannot reach zero before this is added
+	Run(function, context, begin, end, *currentCounter);
+}
+
+void JobSystem::Wait(JobCounter &counter)
+{
+	while (counter.Pending.load(std::memory_order_acquire) != 0)
+	{
+		Job job;
+		if (running && take(job))
+			run(job);
+		else
+			std::this_thread::yield();
+	}
+}
+
+void JobSystem::ParallelFor(unsigned int count, unsigned int chunkSize, void (*function)(void*, unsigned int, unsigned int), void *context)
+{
+	if (count == 0)
+		return;
+	unsigned int chunks = (count + chunkSize - 1) / chunkSize;
+	// nothing to share: run on this thread
+	if (!running || queueCount < 2 || chunks == 1)
+	{
+		for (unsigned int begin = 0; begin < count; begin += chunkSize)
+			function(context, begin, begin + chunkSize < count ? begin + chunkSize : count);
+		return;
+	}
+	JobCounter counter;
+	counter.Pending = chunks;
+	for (unsigned int begin = 0; begin < count; begin += chunkSize)
+	{
+		Job job = { function, context, begin, begin + chunkSize < count ? begin + chunkSize : count, &counter };
+		push(job);
+	}
+	notify();
+	Wait(counter);
+}
+
+void JobSystem::push(const Job &job)
+{
+	WorkQueue &queue = queues[queueIndex];
+	pending.fetch_add(1);
+	{
+		std::lock_guard<std::mutex> lock(queue.Lock);
+		if (queue.Tail - queue.Head < QUEUE_CAPACITY)
+		{
+			queue.Jobs[queue.Tail++ % QUEUE_CAPACITY] = job;
+			return;
+		}
+	}
+	pending.fetch_sub(1);
+	run(job);
+}
+
+void JobSystem::notify()
+{
+	// taking the lock orders this after the sleeping workers' last look at pending
+	{
+		std::lock_guard<std::mutex> lock(sleepLock);
+	}
+	wake.notify_all();
+}
+
+bool JobSystem::take(Job &job)
+{
+	// own deque first, newest job (its data is most likely still in cache)
+	{
+		WorkQueue &queue = queues[queueIndex];
+		std::lock_guard<std::mutex> lock(queue.Lock);
+		if (queue.Tail != queue.Head)
+		{
+			job = queue.Jobs[--queue.Tail % QUEUE_CAPACITY];
+			pending.fetch_sub(1);
+			return true;
+		}
+	}
+	// then steal the oldest job of another thread
+	for (unsigned int i = 1; i < queueCount; ++i)
+	{
+		WorkQueue &victim = queues[(queueIndex + i) % queueCount];
+		std::lock_guard<std::mutex> lock(victim.Lock);
+		if (victim.Tail != victim.Head)
+		{
+			job = victim.Jobs[victim.Head++ % QUEUE_CAPACITY];
+			pending.fetch_sub(1);
+			return true;
+		}
+	}
+	return false;
+}
+
+void JobSystem::run(const Job &job)
+{
+	// children started by the job count against its counter
+	JobCounter *parent = currentCounter;
+	currentCounter = job.Counter;
+	job.Function(job.Context, job.Begin, job.End);
+	currentCounter = parent;
+	job.Counter->Pending.fetch_sub(1, std::memory_order_acq_rel);
+}
+
+void JobSystem::workerLoop(unsigned int index)
+{
+	queueIndex = index;
+	for (;;)
+	{
+		Job job;
+		if (take(job))
+		{
+			run(job);
+			continue;
+		}
+		std::unique_lock<std::mutex> lock(sleepLock);
+		wake.wait(lock, [] { return pending.load() > 0 || !running; });
+		if (!running && pending.load() == 0)
+			return;
+	}
+}
@@ -0,0 +1,95 @@
+#ifndef JOB_SYSTEM_H
+#define JOB_SYSTEM_H
+
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+
+// Counts unfinished jobs. Waiting on a counter returns once every job started
+// with it is done, including the child jobs those jobs started.
+struct JobCounter {
+	std::atomic<unsigned int> Pending;
+
+	JobCounter() : Pending(0) { }
+};
+
+// A unit of work: calls Function(Context, Begin, End), then decrements *Counter
+struct Job {
+	void        (*Function)(void *context, unsigned int begin, unsigned int end);
+	void         *Context;
+	unsigned int  Begin, End;
+	JobCounter   *Counter;
+};
+
+
+// JobSystem is the engine-wide worker pool; features hand it jobs instead of
+// starting threads of their own. It uses work stealing: every thread (the
+// workers, and the thread that called Start as slot 0) owns a deque that it
+// pushes to and pops from at the back, and a thread that runs dry steals from
+// the front of the others'. A job may start children on its own counter, so
+// whoever waits for the job also waits for them, and a thread that waits runs
+// queued jobs instead of blocking. When not started, everything runs on the
+// calling thread. All functions are static; queues never allocate.
+class JobSystem
+{
+public:
+	// jobs each deque holds; jobs pushed to a full deque run immediately
+	static const unsigned int QUEUE_CAPACITY = 1024;
+	// starts the worker threads (0: one per hardware thread besides the caller)
+	static void         Start(unsigned int workerCount = 0);
+	// joins the workers; all counters must have been waited on
+	static void         Stop();
+	// number of worker threads (0 when not started)
+	static unsigned int WorkerCount();
+	// queues function(context, begin, end) on counter; the context must stay valid
+	// until the counter has been waited on
+	static void         Run(void (*function)(void*, unsigned int, unsigned int), void *context,
+	                        unsigned int begin, unsigned int end, JobCounter &counter);
+	// queues a child of the job running on this thread, on that job's counter
+	// (outside of a job it runs right away)
+	static void         RunChild(void (*function)(void*, unsigned int, unsigned int), void *context,
+	                             unsigned int begin, unsigned int end);
+	// runs queued jobs until counter reaches zero
+	static void         Wait(JobCounter &counter);
+	// calls function(context, begin, end) for consecutive chunks of [0, count) of
+	// chunkSize items across all threads and returns when every chunk is done
+	static void         ParallelFor(unsigned int count, unsigned int chunkSize, void (*function)(void*, unsigned int, unsigned int), void *context);
+	template <typename F>
+	static void         ParallelFor(unsigned int count, unsigned int chunkSize, const F &function);
+private:
+	struct WorkQueue {
+		std::mutex   Lock;
+		Job          Jobs[QUEUE_CAPACITY];
+		unsigned int Head, Tail; // Jobs[Head, Tail) modulo QUEUE_CAPACITY
+	};
+	static std::unique_ptr<WorkQueue[]>   queues;
+	static unsigned int                   queueCount;
+	static std::vector<std::thread>       workers;
+	static std::atomic<bool>              running;
+	static std::atomic<unsigned int>      pending;
+	static std::mutex                     sleepLock;
+	static std::condition_variable        wake;
+	// pushes job to the calling thread's deque (or runs it right away if the deque is full)
+	static void push(const Job &job);
+	// wakes sleeping workers after a push
+	static void notify();
+	// takes a job from the calling thread's deque, else steals one
+	static bool take(Job &job);
+	static void run(const Job &job);
+	static void workerLoop(unsigned int index);
+	JobSystem() { }
+};
+
+template <typename F>
+void JobSystem::ParallelFor(unsigned int count, unsigned int chunkSize, const F &function)
+{
+	ParallelFor(count, chunkSize, [](void *context, unsigned int begin, unsigned int end) {
+		(*static_cast<const F*>(context))(begin, end);
+	}, const_cast<F*>(&function));
+}
+
+#endif
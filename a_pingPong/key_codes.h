@@ -0,0 +1,20 @@
+#ifndef KEY_CODES_H
+#define KEY_CODES_H
+
+// The GLFW key codes the game reacts to, with GLFW's values, so the game
+// and the headless tools build without the GLFW headers. GLFW defines the
+// same macros with the same values, so including <GLFW/glfw3.h> before or
+// after this header is fine.
+#define GLFW_KEY_SPACE              32
+#define GLFW_KEY_A                  65
+#define GLFW_KEY_D                  68
+#define GLFW_KEY_S                  83
+#define GLFW_KEY_W                  87
+#define GLFW_KEY_ENTER              257
+#define GLFW_KEY_RIGHT              262
+#define GLFW_KEY_LEFT               263
+#define GLFW_KEY_DOWN               264
+#define GLFW_KEY_UP                 265
+#define GLFW_KEY_F3                 292
+
+#endif
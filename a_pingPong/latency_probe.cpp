@@ -0,0 +1,142 @@
+#include "latency_probe.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <iostream>
+#include <string>
+
+#include "game.h"
+
+// a press that has not moved a paddle after this many seconds is given up on
+const double MAX_LATENCY_SECONDS = 1.0;
+// histogram buckets, in milliseconds; the last one also takes everything slower
+const double BUCKET_MS = 2.0;
+const unsigned int BUCKETS = 32;
+static const char *STAGE_NAMES[LATENCY_STAGES] = { "simulated", "rendered", "presented", "displayed" };
+
+LatencyProbe::LatencyProbe()
+	: Missed(0), phase(IDLE), inputTime(0.0), current(), fence(nullptr)
+{
+	this->paddles[0] = this->paddles[1] = glm::vec2(0.0f);
+}
+
+LatencyProbe::~LatencyProbe()
+{
+	if (this->fence)
+		glDeleteSync(this->fence);
+}
+
+void LatencyProbe::Input(int key, double time)
+{
+	bool paddleKey = key == GLFW_KEY_UP || key == GLFW_KEY_DOWN || key == GLFW_KEY_W || key == GLFW_KEY_S;
+	if (!paddleKey || this->phase != IDLE)
+		return;
+	this->phase = WAIT_SIMULATED;
+	this->inputTime = time;
+}
+
+void LatencyProbe::Simulated(const Game &game, double time)
+{
+	// the paddles are the entities with a score
+	const EntityStore &entities = game.Entities;
+	bool moved = false;
+	for (unsigned int i = 0; i < entities.Scores.Size() && i < 2; ++i)
+	{
+		glm::vec2 position = entities.Transforms.Get(entities.Scores.Entities[i]).Position;
+		moved = moved || position != this->paddles[i];
+		this->paddles[i] = position;
+	}
+	if (this->phase != WAIT_SIMULATED)
+		return;
+	if (moved)
+	{
+		this->current.Stages[LATENCY_SIMULATED] = time - this->inputTime;
+		this->phase = WAIT_RENDERED;
+	}
+	else if (time - this->inputTime > MAX_LATENCY_SECONDS)
+	{
+		++this->Missed;
+		this->phase = IDLE;
+	}
+}
+
+void LatencyProbe::Rendered(double time)
+{
+	if (this->phase != WAIT_RENDERED)
+		return;
+	this->current.Stages[LATENCY_RENDERED] = time - this->inputTime;
+	this->phase = WAIT_PRESENTED;
+}
+
+void LatencyProbe::Presented(double time)
+{
+	if (this->phase != WAIT_PRESENTED)
+		return;
+	this->current.Stages[LATENCY_PRESENTED] = time - this->inputTime;
+	this->phase = WAIT_DISPLAYED;
+	this->fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+void LatencyProbe::Poll(double time)
+{
+	if (this->phase != WAIT_DISPLAYED || !this->fence)
+		return;
+	// never waits: a frame that is not finished yet is checked again next frame
+	GLenum status = glClientWaitSync(this->fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+	if (status == GL_ALREADY_SIGNALED || status == GL_CONDITION_SATISFIED)
+		this->Displayed(time);
+}
+
+void LatencyProbe::Displayed(double time)
+{
+	if (this->phase != WAIT_DISPLAYED)
+		return;
+	if (this->fence)
+		glDeleteSync(this->fence);
+	this->fence = nullptr;
+	this->current.Stages[LATENCY_DISPLAYED] = time - this->inputTime;
+	this->Samples.push_back(this->current);
+	this->phase = IDLE;
+}
+
+void LatencyProbe::Report() const
+{
+	std::cout << "input-to-display latency of " << this->Samples.size() << " presses";
+	if (this->Missed)
+		std::cout << " (" << this->Missed << " moved no paddle)";
+	std::cout << std::endl;
+	if (this->Samples.empty())
+		return;
+	// histogram of the total latency, from the first to the last filled bucket
+	unsigned int counts[BUCKETS] = {}, largest = 0;
+	for (const LatencySample &sample : this->Samples)
+	{
+		unsigned int bucket = static_cast<unsigned int>(sample.Stages[LATENCY_DISPLAYED] * 1000.0 / BUCKET_MS);
+		largest = std::max(largest, ++counts[std::min(bucket, BUCKETS - 1)]);
+	}
+	unsigned int first = 0, last = BUCKETS - 1;
+	while (counts[first] == 0)
+		++first;
+	while (counts[last] == 0)
+		--last;
+	char line[64];
+	for (unsigned int bucket = first; bucket <= last; ++bucket)
+	{
+		if (bucket == BUCKETS - 1)
+			snprintf(line, sizeof(line), "  %5.1f+     ms %5u ", bucket * BUCKET_MS, counts[bucket]);
+		else
+			snprintf(line, sizeof(line), "  %5.1f-%5.1f ms %5u ", bucket * BUCKET_MS, (bucket + 1) * BUCKET_MS, counts[bucket]);
+		std::cout << line << std::string(counts[bucket] * 50 / largest, '#') << std::endl;
+	}
+	// how the latency builds up: percentiles of the time from the key event to each stage
+	std::vector<double> times(this->Samples.size());
+	for (unsigned int stage = 0; stage < LATENCY_STAGES; ++stage)
+	{
+		for (size_t i = 0; i < this->Samples.size(); ++i)
+			times[i] = this->Samples[i].Stages[stage] * 1000.0;
+		std::sort(times.begin(), times.end());
+		snprintf(line, sizeof(line), "  %-9s p50 %6.2f ms  p99 %6.2f ms  max %6.2f ms", STAGE_NAMES[stage],
+			times[times.size() / 2], times[std::min(times.size() - 1, times.size() * 99 / 100)], times.back());
+		std::cout << line << std::endl;
+	}
+}
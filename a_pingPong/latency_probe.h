@@ -0,0 +1,68 @@
+#ifndef LATENCY_PROBE_H
+#define LATENCY_PROBE_H
+
+#include <vector>
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+class Game;
+
+// Points an input passes on its way to the screen, after the key event itself
+enum LatencyStage {
+	LATENCY_SIMULATED, // the tick that moved a paddle finished
+	LATENCY_RENDERED,  // Render returned for the first frame showing the move
+	LATENCY_PRESENTED, // glfwSwapBuffers (headless: glFlush) returned for it
+	LATENCY_DISPLAYED, // the GPU finished the frame (headless: it was read back)
+	LATENCY_STAGES
+};
+
+// Seconds from the key event to each stage
+struct LatencySample {
+	double Stages[LATENCY_STAGES];
+};
+
+
+// LatencyProbe measures input-to-photon latency: it follows one paddle key
+// press at a time from key_callback through the tick whose ProcessInput
+// moved a paddle, Render and the buffer swap, to the frame it first shows
+// up in. The window cannot see the display, so a frame counts as shown
+// once the GPU has finished it (a fence after the swap); the headless
+// driver reads the frames back and looks for the paddle instead. Presses
+// while one is in flight are not followed, and a press that never moves a
+// paddle (one against the wall) is dropped after a second.
+class LatencyProbe
+{
+public:
+	// state
+	std::vector<LatencySample> Samples;
+	unsigned int               Missed;
+	// constructor/destructor
+	LatencyProbe();
+	~LatencyProbe();
+	// a key went down at time (seconds, the clock of every other call); starts following it if it moves a paddle
+	void Input(int key, double time);
+	// after each tick: a followed press has been simulated once the paddles moved
+	void Simulated(const Game &game, double time);
+	// after Render
+	void Rendered(double time);
+	// after the buffer swap; fences the frame if it carries a followed press
+	void Presented(double time);
+	// once per frame: records the sample when its fenced frame has finished on the GPU
+	void Poll(double time);
+	// for callers that see the frames themselves (headless): the presented frame is on screen
+	void Displayed(double time);
+	// whether a press is being followed
+	bool Busy() const { return this->phase != IDLE; }
+	// prints a histogram of the input-to-display latencies and the percentiles of every stage
+	void Report() const;
+private:
+	enum Phase { IDLE, WAIT_SIMULATED, WAIT_RENDERED, WAIT_PRESENTED, WAIT_DISPLAYED };
+	Phase         phase;
+	double        inputTime;
+	LatencySample current;
+	GLsync        fence;
+	glm::vec2     paddles[2];
+};
+
+#endif
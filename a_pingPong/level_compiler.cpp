@@ -0,0 +1,28 @@
+#include <iostream>
+#include <vector>
+
+#include "game_level.h"
+
+// pingpong_levelc compiles the level files named in a level list into the
+// binary pack the game loads with a single read:
+//   pingpong_levelc levels/levels.txt levels/levels.bin
+int main(int argc, char *argv[])
+{
+	if (argc != 3)
+	{
+		std::cout << "usage: " << argv[0] << " levels.txt levels.bin" << std::endl;
+		return -1;
+	}
+	std::vector<GameLevel> levels;
+	if (!GameLevel::LoadList(argv[1], levels) || !GameLevel::SavePack(argv[2], levels))
+		return -1;
+	// read the pack back so a broken one fails the build rather than the game
+	std::vector<GameLevel> check;
+	if (!GameLevel::LoadPack(argv[2], check) || check.size() != levels.size())
+	{
+		std::cout << "ERROR::LEVEL: " << argv[2] << " does not read back" << std::endl;
+		return -1;
+	}
+	std::cout << "compiled " << levels.size() << " levels into " << argv[2] << std::endl;
+	return 0;
+}
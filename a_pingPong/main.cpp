@@ -1,9 +1,20 @@
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
 
+#include "frame_pacer.h"
 #include "game.h"
+#include "input_queue.h"
+#include "job_system.h"
+#include "latency_probe.h"
+#include "profiler.h"
+#include "replay.h"
 #include "resource_manager.h"
+#include "state_hash.h"
 
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
 #include <iostream>
 
 // GLFW function declarations
@@ -15,10 +26,82 @@ const unsigned int SCREEN_WIDTH = 900;
 // The height of the screen
 const unsigned int SCREEN_HEIGHT = 600;
 
+// The simulation runs in fixed ticks of this length, whatever the frame rate
+const double TICK_SECONDS = 1.0 / 120.0;
+// Longest stretch of time simulated after a stall (window dragged, debugger); the rest is skipped
+const double MAX_CATCH_UP_SECONDS = 0.25;
+
 Game PingPong(SCREEN_WIDTH, SCREEN_HEIGHT);
 
+// key events from key_callback, applied by the tick they happened in
+InputQueue     Input;
+// input recording (--record), one frame per tick
+const char    *RecordFile = nullptr;
+Replay         Recording;
+// state of every tick (--state-log), for finding where a replay or a peer diverges
+const char    *StateLogFile = nullptr;
+StateLog       States;
+// when frames start (--pacing, --fps); with --power-save the menu and win
+// screens sleep until an event arrives, since nothing moves on them
+FramePacer     Pacer;
+bool           PowerSave = false;
+// input-to-display latency of the paddle keys (--latency), reported at exit
+bool           MeasureLatency = false;
+LatencyProbe  *Latency = nullptr;
+// Chrome trace written by the profiler (--trace)
+const char    *TraceFile = nullptr;
+
 int main(int argc, char *argv[])
 {
+	// command line options
+	// --------------------
+	for (int i = 1; i < argc; ++i)
+	{
+		if (strcmp(argv[i], "--audio-wav") == 0 && i + 1 < argc)
+			PingPong.AudioCapture = argv[++i];
+		else if (strcmp(argv[i], "--record") == 0 && i + 1 < argc)
+			RecordFile = argv[++i];
+		else if (strcmp(argv[i], "--state-log") == 0 && i + 1 < argc)
+			StateLogFile = argv[++i];
+		else if (strcmp(argv[i], "--pacing") == 0 && i + 1 < argc)
+		{
+			++i;
+			Pacer.Mode = strcmp(argv[i], "low-latency") == 0 ? PACING_LOW_LATENCY : strcmp(argv[i], "cap") == 0 ? PACING_CAP : PACING_OFF;
+		}
+		else if (strcmp(argv[i], "--fps") == 0 && i + 1 < argc)
+			Pacer.FpsCap = static_cast<unsigned int>(atoi(argv[++i]));
+		else if (strcmp(argv[i], "--power-save") == 0)
+			PowerSave = true;
+		else if (strcmp(argv[i], "--resolution-scale") == 0 && i + 1 < argc)
+			PingPong.ResolutionScale = static_cast<float>(atof(argv[++i]));
+		else if (strcmp(argv[i], "--dynamic-resolution") == 0)
+			PingPong.DynamicResolution = true;
+		else if (strcmp(argv[i], "--quality-budget") == 0 && i + 1 < argc)
+			PingPong.QualityBudget = static_cast<float>(atof(argv[++i]));
+		else if (strcmp(argv[i], "--latency") == 0)
+			MeasureLatency = true;
+		else if (strcmp(argv[i], "--trace") == 0 && i + 1 < argc)
+			TraceFile = argv[++i];
+		else if (strcmp(argv[i], "--particles") == 0 && i + 1 < argc)
+			PingPong.ParticleCount = static_cast<unsigned int>(atoi(argv[++i]));
+		else if (strcmp(argv[i], "--gpu-particles") == 0 && i + 1 < argc)
+			PingPong.GpuParticleCount = static_cast<unsigned int>(atoi(argv[++i]));
+		else if (strcmp(argv[i], "--balls") == 0 && i + 1 < argc)
+			PingPong.BallCount = std::max(1, atoi(argv[++i]));
+		else if (strcmp(argv[i], "--fixed-point") == 0)
+			PingPong.FixedPoint = true;
+	}
+	if (RecordFile)
+	{
+		// particles are randomized; store the seed so replays look the same
+		Recording.Seed = static_cast<unsigned int>(time(nullptr));
+		srand(Recording.Seed);
+		Recording.FixedPoint = PingPong.FixedPoint;
+		Recording.BallCount = PingPong.BallCount;
+	}
+	if (StateLogFile && !States.Open(StateLogFile))
+		return -1;
+
 	glfwInit();
 	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
 	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
@@ -39,6 +122,17 @@ int main(int argc, char *argv[])
 		return -1;
 	}
 
+	// low-latency pacing times frames against the vblank, the cap replaces vsync
+	if (Pacer.Mode == PACING_LOW_LATENCY)
+	{
+		glfwSwapInterval(1);
+		const GLFWvidmode *mode = glfwGetVideoMode(glfwGetPrimaryMonitor());
+		if (mode && mode->refreshRate > 0)
+			Pacer.RefreshRate = mode->refreshRate;
+	}
+	else if (Pacer.Mode == PACING_CAP)
+		glfwSwapInterval(0);
+
 	glfwSetKeyCallback(window, key_callback);
 	glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
 
@@ -50,42 +144,99 @@ int main(int argc, char *argv[])
 
 	// initialize game
 	// ---------------
+	JobSystem::Start();
 	PingPong.Init();
+	if (MeasureLatency)
+		Latency = new LatencyProbe();
+#ifdef PINGPONG_PROFILE
+	Profiler::Start(TraceFile, true);
+#endif
 
-	// deltaTime variables
-	// -------------------
-	float deltaTime = 0.0f;
-	float lastFrame = 0.0f;
+	// fixed-step game loop
+	// --------------------
+	// simTime is where the simulation has got to; every frame runs the ticks
+	// that fit before the current time, each with the input that happened in it
+	const float tickSeconds = static_cast<float>(TICK_SECONDS);
+	double simTime = glfwGetTime();
 
 	while (!glfwWindowShouldClose(window))
 	{
-		// calculate delta time
-		// --------------------
-		float currentFrame = glfwGetTime();
-		deltaTime = currentFrame - lastFrame;
-		lastFrame = currentFrame;
-		glfwPollEvents();
+		PROFILE_FRAME();
+		{
+			PROFILE_SCOPE("Pacing");
+			Pacer.BeginFrame();
+		}
+		if (PowerSave && PingPong.State != GAME_ACTIVE)
+		{
+			glfwWaitEvents();
+			// the wait is not simulated: one tick applies whatever woke us
+			simTime = std::max(simTime, glfwGetTime() - TICK_SECONDS);
+		}
+		else
+			glfwPollEvents();
+		double now = glfwGetTime();
+		if (Latency)
+			Latency->Poll(now);
+		simTime = std::max(simTime, now - MAX_CATCH_UP_SECONDS);
+		while (simTime + TICK_SECONDS <= now)
+		{
+			simTime += TICK_SECONDS;
+			unsigned short released = Input.Apply(PingPong, simTime);
+			if (RecordFile)
+			{
+				ReplayFrame frame = { tickSeconds, Replay::HeldKeys(PingPong), released };
+				Recording.Frames.push_back(frame);
+			}
 
-		// manage user input
-		// -----------------
-		PingPong.ProcessInput(deltaTime);
+			// manage user input
+			// -----------------
+			PingPong.ProcessInput(tickSeconds);
 
-		// update game state
-		// -----------------
-		PingPong.Update(deltaTime);
+			// update game state
+			// -----------------
+			PingPong.Update(tickSeconds);
+			if (StateLogFile)
+				States.Record(PingPong);
+			if (Latency)
+				Latency->Simulated(PingPong, glfwGetTime());
+		}
 
 		// render
 		// ------
 		glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
 		glClear(GL_COLOR_BUFFER_BIT);
 		PingPong.Render();
+		if (Latency)
+			Latency->Rendered(glfwGetTime());
 
+		Pacer.EndFrame();
 		glfwSwapBuffers(window);
+		// waiting for the GPU makes the swap return at the vblank, which low-latency pacing measures from
+		if (Pacer.Mode == PACING_LOW_LATENCY)
+			glFinish();
+		Pacer.Presented();
+		if (Latency)
+			Latency->Presented(glfwGetTime());
+	}
+
+#ifdef PINGPONG_PROFILE
+	Profiler::Stop();
+#endif
+	JobSystem::Stop();
+	if (Latency)
+	{
+		Latency->Report();
+		delete Latency;
 	}
 
 	// delete all resources as loaded using the resource manager
 	// ---------------------------------------------------------
 	ResourceManager::Clear();
+	if (RecordFile)
+		Recording.Save(RecordFile);
+	States.Close();
+	if (Input.Dropped)
+		std::cout << "ERROR::INPUT: " << Input.Dropped << " key events were dropped (queue full)" << std::endl;
 
 	glfwTerminate();
 	return 0;
@@ -96,15 +247,13 @@ void key_callback(GLFWwindow* window, int key, int scancode, int action, int mod
 	// when a user presses the escape key, we set the WindowShouldClose property to true, closing the application
 	if (key == GLFW_KEY_ESCAPE && action == GLFW_PRESS)
 		glfwSetWindowShouldClose(window, true);
-	if (key >= 0 && key < 1024)
+	// the simulation applies the event at the tick it happened in
+	if (action == GLFW_PRESS || action == GLFW_RELEASE)
 	{
-		if (action == GLFW_PRESS)
-			PingPong.Keys[key] = true;
-		else if (action == GLFW_RELEASE)
-		{
-			PingPong.Keys[key] = false;
-			PingPong.KeysProcessed[key] = false;
-		}
+		InputEvent event = { glfwGetTime(), key, action == GLFW_PRESS };
+		Input.Push(event);
+		if (Latency && event.Pressed)
+			Latency->Input(key, event.Time);
 	}
 }
 
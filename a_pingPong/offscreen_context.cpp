@@ -0,0 +1,210 @@
+#include "offscreen_context.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <iostream>
+
+#include <glad/glad.h>
+
+#ifdef PINGPONG_USE_OSMESA
+#include <GL/osmesa.h>
+#else
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#endif
+
+
+OffscreenContext::OffscreenContext()
+	: Width(0), Height(0), display(nullptr), surface(nullptr), context(nullptr), framebuffer(0), colorbuffer(0) { }
+
+OffscreenContext::~OffscreenContext()
+{
+	this->Destroy();
+}
+
+#ifdef PINGPONG_USE_OSMESA
+bool OffscreenContext::Create(unsigned int width, unsigned int height)
+{
+	const int attributes[] = {
+		OSMESA_FORMAT, OSMESA_RGBA,
+		OSMESA_DEPTH_BITS, 0,
+		OSMESA_PROFILE, OSMESA_CORE_PROFILE,
+		OSMESA_CONTEXT_MAJOR_VERSION, 3,
+		OSMESA_CONTEXT_MINOR_VERSION, 3,
+		0
+	};
+	OSMesaContext osmesa = OSMesaCreateContextAttribs(attributes, nullptr);
+	if (!osmesa)
+	{
+		std::cout << "ERROR::OFFSCREEN: Failed to create OSMesa context" << std::endl;
+		return false;
+	}
+	this->context = osmesa;
+	this->buffer.resize(width * height * 4);
+	if (!OSMesaMakeCurrent(osmesa, &this->buffer[0], GL_UNSIGNED_BYTE, width, height))
+	{
+		std::cout << "ERROR::OFFSCREEN: Failed to make OSMesa context current" << std::endl;
+		this->Destroy();
+		return false;
+	}
+	this->Width = width;
+	this->Height = height;
+	if (!gladLoadGLLoader((GLADloadproc)OffscreenContext::GetProcAddress))
+	{
+		std::cout << "Failed to initialize GLAD" << std::endl;
+		this->Destroy();
+		return false;
+	}
+	return true;
+}
+
+void OffscreenContext::Destroy()
+{
+	if (this->context)
+		OSMesaDestroyContext(static_cast<OSMesaContext>(this->context));
+	this->context = nullptr;
+	this->buffer.clear();
+}
+
+void *OffscreenContext::GetProcAddress(const char *name)
+{
+	return reinterpret_cast<void*>(OSMesaGetProcAddress(name));
+}
+#else
+bool OffscreenContext::Create(unsigned int width, unsigned int height)
+{
+	// prefer Mesa's surfaceless platform, which needs neither a display server nor a GPU
+	EGLDisplay dpy = EGL_NO_DISPLAY;
+#ifdef EGL_PLATFORM_SURFACELESS_MESA
+	PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay = (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+	if (getPlatformDisplay)
+		dpy = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+#endif
+	if (dpy == EGL_NO_DISPLAY)
+		dpy = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+	EGLint major, minor;
+	if (dpy == EGL_NO_DISPLAY || !eglInitialize(dpy, &major, &minor) || !eglBindAPI(EGL_OPENGL_API))
+	{
+		std::cout << "ERROR::OFFSCREEN: Failed to initialize EGL" << std::endl;
+		return false;
+	}
+	this->display = dpy;
+	// look for a pbuffer config first; fall back to any desktop GL config and an FBO
+	EGLint configAttributes[] = {
+		EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+		EGL_RED_SIZE, 8, EGL_GREEN_SIZE, 8, EGL_BLUE_SIZE, 8, EGL_ALPHA_SIZE, 8,
+		EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+		EGL_NONE
+	};
+	EGLConfig config;
+	EGLint count = 0;
+	bool pbuffer = eglChooseConfig(dpy, configAttributes, &config, 1, &count) && count > 0;
+	if (!pbuffer)
+	{
+		configAttributes[1] = 0;
+		if (!eglChooseConfig(dpy, configAttributes, &config, 1, &count) || count == 0)
+		{
+			std::cout << "ERROR::OFFSCREEN: No suitable EGL config" << std::endl;
+			this->Destroy();
+			return false;
+		}
+	}
+	EGLSurface eglSurface = EGL_NO_SURFACE;
+	if (pbuffer)
+	{
+		const EGLint surfaceAttributes[] = { EGL_WIDTH, (EGLint)width, EGL_HEIGHT, (EGLint)height, EGL_NONE };
+		eglSurface = eglCreatePbufferSurface(dpy, config, surfaceAttributes);
+	}
+	this->surface = eglSurface;
+	const EGLint contextAttributes[] = {
+		EGL_CONTEXT_MAJOR_VERSION, 3,
+		EGL_CONTEXT_MINOR_VERSION, 3,
+		EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+		EGL_NONE
+	};
+	EGLContext eglContext = eglCreateContext(dpy, config, EGL_NO_CONTEXT, contextAttributes);
+	if (eglContext == EGL_NO_CONTEXT || !eglMakeCurrent(dpy, eglSurface, eglSurface, eglContext))
+	{
+		std::cout << "ERROR::OFFSCREEN: Failed to create EGL context" << std::endl;
+		this->context = eglContext;
+		this->Destroy();
+		return false;
+	}
+	this->context = eglContext;
+	this->Width = width;
+	this->Height = height;
+	if (!gladLoadGLLoader((GLADloadproc)OffscreenContext::GetProcAddress))
+	{
+		std::cout << "Failed to initialize GLAD" << std::endl;
+		this->Destroy();
+		return false;
+	}
+	// without a pbuffer there is no default framebuffer, so render into our own
+	if (eglSurface == EGL_NO_SURFACE)
+	{
+		glGenRenderbuffers(1, &this->colorbuffer);
+		glBindRenderbuffer(GL_RENDERBUFFER, this->colorbuffer);
+		glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+		glGenFramebuffers(1, &this->framebuffer);
+		glBindFramebuffer(GL_FRAMEBUFFER, this->framebuffer);
+		glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, this->colorbuffer);
+		if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+		{
+			std::cout << "ERROR::OFFSCREEN: Framebuffer is not complete" << std::endl;
+			this->Destroy();
+			return false;
+		}
+	}
+	return true;
+}
+
+void OffscreenContext::Destroy()
+{
+	if (!this->display)
+		return;
+	EGLDisplay dpy = static_cast<EGLDisplay>(this->display);
+	if (this->framebuffer)
+	{
+		glDeleteFramebuffers(1, &this->framebuffer);
+		glDeleteRenderbuffers(1, &this->colorbuffer);
+		this->framebuffer = this->colorbuffer = 0;
+	}
+	eglMakeCurrent(dpy, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+	if (this->context && this->context != EGL_NO_CONTEXT)
+		eglDestroyContext(dpy, static_cast<EGLContext>(this->context));
+	if (this->surface && this->surface != EGL_NO_SURFACE)
+		eglDestroySurface(dpy, static_cast<EGLSurface>(this->surface));
+	eglTerminate(dpy);
+	this->display = this->surface = this->context = nullptr;
+}
+
+void *OffscreenContext::GetProcAddress(const char *name)
+{
+	return reinterpret_cast<void*>(eglGetProcAddress(name));
+}
+#endif
+
+void OffscreenContext::ReadPixels(std::vector<unsigned char> &pixels)
+{
+	pixels.resize(this->Width * this->Height * 3);
+	glPixelStorei(GL_PACK_ALIGNMENT, 1);
+	glReadPixels(0, 0, this->Width, this->Height, GL_RGB, GL_UNSIGNED_BYTE, &pixels[0]);
+	// GL returns the bottom row first
+	unsigned int stride = this->Width * 3;
+	for (unsigned int y = 0; y < this->Height / 2; ++y)
+		std::swap_ranges(pixels.begin() + y * stride, pixels.begin() + (y + 1) * stride, pixels.begin() + (this->Height - 1 - y) * stride);
+}
+
+bool WritePPM(const char *file, const std::vector<unsigned char> &pixels, unsigned int width, unsigned int height)
+{
+	FILE *out = fopen(file, "wb");
+	if (!out)
+	{
+		std::cout << "ERROR::OFFSCREEN: Failed to open " << file << std::endl;
+		return false;
+	}
+	fprintf(out, "P6\n%u %u\n255\n", width, height);
+	fwrite(&pixels[0], 1, width * height * 3, out);
+	fclose(out);
+	return true;
+}
@@ -0,0 +1,39 @@
+#ifndef OFFSCREEN_CONTEXT_H
+#define OFFSCREEN_CONTEXT_H
+
+#include <vector>
+
+
+// OffscreenContext creates an OpenGL 3.3 core context without a window,
+// so the game can render on machines with no display or GPU (Mesa's
+// llvmpipe/softpipe rasterizers). It uses an EGL pbuffer by default, or
+// OSMesa when built with PINGPONG_USE_OSMESA.
+class OffscreenContext
+{
+public:
+	// constructor/destructor
+	OffscreenContext();
+	~OffscreenContext();
+	// creates the context with a width x height RGBA color buffer, makes it current and loads the GL functions
+	bool Create(unsigned int width, unsigned int height);
+	// releases the context
+	void Destroy();
+	// looks up an OpenGL function; pass to gladLoadGLLoader
+	static void *GetProcAddress(const char *name);
+	// reads back the current color buffer as tightly packed RGB rows, top row first
+	void ReadPixels(std::vector<unsigned char> &pixels);
+	// size of the color buffer
+	unsigned int Width, Height;
+private:
+	// platform handles (EGLDisplay/EGLSurface/EGLContext or OSMesaContext)
+	void *display, *surface, *context;
+	// used instead of a pbuffer when the EGL platform has none (e.g. Mesa's surfaceless platform)
+	unsigned int framebuffer, colorbuffer;
+	// OSMesa renders into client memory
+	std::vector<unsigned char> buffer;
+};
+
+// writes tightly packed RGB pixels (top row first) as a binary PPM image
+bool WritePPM(const char *file, const std::vector<unsigned char> &pixels, unsigned int width, unsigned int height);
+
+#endif
@@ -1,28 +1,107 @@
 #include "particle_generator.h"
+#include "frame_arena.h"
+#include "job_system.h"
 
-ParticleGenerator::ParticleGenerator(Shader shader, Texture2D texture, unsigned int amount)
-	: shader(shader), texture(texture), amount(amount)
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
+// particles per job; a multiple of ParticleLanes::LANE_WIDTH, so every chunk starts on aligned lanes
+static const unsigned int CHUNK_SIZE = 16384;
+
+// counter-based random numbers (lowbias32 hash of the spawn number): the n-th particle a
+// generator spawns gets the same numbers whichever thread spawns it, so the particles
+// only depend on the seed and not on how the work is split
+static unsigned int spawnRandom(unsigned int seed, unsigned int spawn)
 {
-	this->init();
+	unsigned int x = spawn * 0x9e3779b9u ^ seed;
+	x ^= x >> 16;
+	x *= 0x7feb352du;
+	x ^= x >> 15;
+	x *= 0x846ca68bu;
+	x ^= x >> 16;
+	return x;
 }
 
-void ParticleGenerator::Update(float dt, GameObject &object, unsigned int newParticles, glm::vec2 offset)
+// advances particles [begin, end) by dt without branches: particles that die this step
+// are integrated too, but are removed before anything reads them
+static void integrateParticles(const ParticleLanes &lanes, unsigned int begin, unsigned int end, float dt)
 {
-	// add new particles 
-	for (unsigned int i = 0; i < newParticles; ++i)
+	// lanes are padded, so round up to whole registers
+	unsigned int padded = (end + ParticleLanes::LANE_WIDTH - 1) / ParticleLanes::LANE_WIDTH * ParticleLanes::LANE_WIDTH;
+	float fade = dt * 2.5f;
+#ifdef __AVX2__
+	__m256 step = _mm256_set1_ps(dt);
+	__m256 fadeStep = _mm256_set1_ps(fade);
+	for (unsigned int i = begin; i < padded; i += 8)
+	{
+		_mm256_store_ps(lanes.Life + i, _mm256_sub_ps(_mm256_load_ps(lanes.Life + i), step));
+		_mm256_store_ps(lanes.PositionX + i, _mm256_sub_ps(_mm256_load_ps(lanes.PositionX + i),
+			_mm256_mul_ps(_mm256_load_ps(lanes.VelocityX + i), step)));
+		_mm256_store_ps(lanes.PositionY + i, _mm256_sub_ps(_mm256_load_ps(lanes.PositionY + i),
+			_mm256_mul_ps(_mm256_load_ps(lanes.VelocityY + i), step)));
+		_mm256_store_ps(lanes.A + i, _mm256_sub_ps(_mm256_load_ps(lanes.A + i), fadeStep));
+	}
+#else
+	// plain loops over restrict pointers, which compilers vectorize for the target's SIMD width
+	float *__restrict life = lanes.Life;
+	float *__restrict positionX = lanes.PositionX;
+	float *__restrict positionY = lanes.PositionY;
+	const float *__restrict velocityX = lanes.VelocityX;
+	const float *__restrict velocityY = lanes.VelocityY;
+	float *__restrict alpha = lanes.A;
+	for (unsigned int i = begin; i < padded; ++i)
 	{
-		int unusedParticle = this->firstUnusedParticle();
-		this->respawnParticle(this->particles[unusedParticle], object, offset);
+		life[i] -= dt;
+		positionX[i] -= velocityX[i] * dt;
+		positionY[i] -= velocityY[i] * dt;
+		alpha[i] -= fade;
 	}
-	// update all particles
-	for (unsigned int i = 0; i < this->amount; ++i)
+#endif
+}
+
+ParticleGenerator::ParticleGenerator(Shader shader, Texture2D texture, unsigned int amount, unsigned int seed)
+	: amount(amount), limit(amount), live(0), seed(seed), spawned(0), shader(shader), texture(texture)
+{
+	this->init();
+}
+
+void ParticleGenerator::Update(float dt, glm::vec2 position, glm::vec2 velocity, unsigned int newParticles, glm::vec2 offset)
+{
+	// add new particles at the end of the live range; when the pool is full (up to the limit) the
+	// rest are dropped (if that happens repeatedly, more particles should be reserved)
+	unsigned int first = this->live;
+	unsigned int spawn = this->live < this->limit ? std::min(newParticles, this->limit - this->live) : 0;
+	JobSystem::ParallelFor(spawn, CHUNK_SIZE, [&](unsigned int begin, unsigned int end) {
+		for (unsigned int i = begin; i < end; ++i)
+			this->respawnParticle(first + i, this->spawned + i, position, velocity, offset);
+	});
+	this->spawned += spawn;
+	this->live += spawn;
+	// update the live particles in chunks across the job system; each chunk notes which of its particles died
+	JobSystem::ParallelFor(this->live, CHUNK_SIZE, [this, dt](unsigned int begin, unsigned int end) {
+		integrateParticles(this->particles, begin, end, dt);
+		unsigned int dead = 0;
+		for (unsigned int i = begin; i < end; ++i)
+			if (this->particles.Life[i] <= 0.0f)
+				this->dead[begin + dead++] = i;
+		this->deadCounts[begin / CHUNK_SIZE] = dead;
+	});
+	// then remove the dead in ascending order by moving the last live particle into their slot
+	unsigned int updated = this->live;
+	for (unsigned int begin = 0; begin < updated; begin += CHUNK_SIZE)
 	{
-		Particle &p = this->particles[i];
-		p.Life -= dt; // reduce life
-		if (p.Life > 0.0f)
-		{	// particle is alive, thus update
-			p.Position -= p.Velocity * dt;
-			p.Color.a -= dt * 2.5f;
+		for (unsigned int k = 0; k < this->deadCounts[begin / CHUNK_SIZE]; ++k)
+		{
+			unsigned int slot = this->dead[begin + k];
+			// dead particles at the end are dropped rather than moved
+			while (this->live > slot && this->particles.Life[this->live - 1] <= 0.0f)
+				--this->live;
+			if (slot < this->live)
+				this->moveParticle(--this->live, slot);
 		}
 	}
 }
@@ -30,21 +109,55 @@ void ParticleGenerator::Update(float dt, GameObject &object, unsigned int newPar
 // render all particles
 void ParticleGenerator::Draw()
 {
-	// use additive blending to give it a 'glow' effect
-	glBlendFunc(GL_SRC_ALPHA, GL_ONE);
-	this->shader.Use();
-	for (Particle particle : this->particles)
+	// gather the live particles as instances (offset, color) in frame memory
+	unsigned int count = this->live;
+	if (count == 0)
+		return;
+	float *instanceData = FrameArena::Allocate<float>(count * 6);
+	for (unsigned int i = 0; i < count; ++i)
 	{
-		if (particle.Life > 0.0f)
-		{
-			this->shader.SetVector2f("offset", particle.Position);
-			this->shader.SetVector4f("color", particle.Color);
-			this->texture.Bind();
-			glBindVertexArray(this->VAO);
-			glDrawArrays(GL_TRIANGLES, 0, 6);
-			glBindVertexArray(0);
-		}
+		float *instance = instanceData + i * 6;
+		instance[0] = this->particles.PositionX[i];
+		instance[1] = this->particles.PositionY[i];
+		instance[2] = this->particles.R[i];
+		instance[3] = this->particles.G[i];
+		instance[4] = this->particles.B[i];
+		instance[5] = this->particles.A[i];
 	}
+	this->drawInstances(instanceData, count);
+}
+
+void ParticleGenerator::Prime()
+{
+	// fully transparent, so it adds nothing to the glow
+	const float instance[6] = { 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f };
+	this->drawInstances(instance, 1);
+}
+
+void ParticleGenerator::drawInstances(const float *instanceData, unsigned int count)
+{
+	// copy them into the stream buffer and point the instance attributes at where they landed
+	glBindVertexArray(this->VAO);
+	glBindBuffer(GL_ARRAY_BUFFER, this->instances.ID);
+	size_t offset;
+	void *memory = this->instances.Map(count * 6 * sizeof(float), 6 * sizeof(float), offset);
+	if (!memory)
+	{
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+		glBindVertexArray(0);
+		return;
+	}
+	memcpy(memory, instanceData, count * 6 * sizeof(float));
+	this->instances.Unmap();
+	glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)offset);
+	glVertexAttribPointer(2, 4, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)(offset + 2 * sizeof(float)));
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	// use additive blending to give it a 'glow' effect, and draw all particles at once
+	glBlendFunc(GL_SRC_ALPHA, GL_ONE);
+	this->shader.Use();
+	this->texture.Bind();
+	glDrawArraysInstanced(GL_TRIANGLES, 0, 6, count);
+	glBindVertexArray(0);
 	// don't forget to reset to default blending mode
 	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 }
@@ -71,42 +184,62 @@ void ParticleGenerator::init()
 	// set mesh attributes
 	glEnableVertexAttribArray(0);
 	glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)0);
+	// per-instance offset and color, streamed every frame by Draw (which also sets their offsets);
+	// each region holds two frames of a full pool
+	this->instances.Init(StreamBuffer::REGIONS * 2 * this->amount * 6 * sizeof(float));
+	glBindBuffer(GL_ARRAY_BUFFER, this->instances.ID);
+	glEnableVertexAttribArray(1);
+	glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)0);
+	glVertexAttribDivisor(1, 1);
+	glEnableVertexAttribArray(2);
+	glVertexAttribPointer(2, 4, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)(2 * sizeof(float)));
+	glVertexAttribDivisor(2, 1);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
 	glBindVertexArray(0);
 
-	// create this->amount default particle instances
-	for (unsigned int i = 0; i < this->amount; ++i)
-		this->particles.push_back(Particle());
+	// per-chunk bookkeeping of Update
+	this->dead.assign(this->amount, 0);
+	this->deadCounts.assign((this->amount + CHUNK_SIZE - 1) / CHUNK_SIZE, 0);
+	// allocate the lanes for this->amount particles in one block, each lane 32-byte aligned
+	unsigned int stride = (this->amount + ParticleLanes::LANE_WIDTH - 1) / ParticleLanes::LANE_WIDTH * ParticleLanes::LANE_WIDTH;
+	this->storage.assign(9 * stride + ParticleLanes::LANE_WIDTH, 0.0f);
+	float *lane = this->storage.data();
+	lane += (32 - reinterpret_cast<std::uintptr_t>(lane) % 32) % 32 / sizeof(float);
+	float **lanes[] = { &this->particles.PositionX, &this->particles.PositionY, &this->particles.VelocityX, &this->particles.VelocityY,
+		&this->particles.R, &this->particles.G, &this->particles.B, &this->particles.A, &this->particles.Life };
+	for (float **pointer : lanes)
+	{
+		*pointer = lane;
+		lane += stride;
+	}
 }
 
-// stores the index of the last particle used (for quick access to next dead particle)
-unsigned int lastUsedParticle = 0;
-unsigned int ParticleGenerator::firstUnusedParticle()
+void ParticleGenerator::respawnParticle(unsigned int particle, unsigned int spawn, glm::vec2 position, glm::vec2 velocity, glm::vec2 offset)
 {
-	// first search from last used particle, this will usually return almost instantly
-	for (unsigned int i = lastUsedParticle; i < this->amount; ++i) {
-		if (this->particles[i].Life <= 0.0f) {
-			lastUsedParticle = i;
-			return i;
-		}
-	}
-	// otherwise, do a linear search
-	for (unsigned int i = 0; i < lastUsedParticle; ++i) {
-		if (this->particles[i].Life <= 0.0f) {
-			lastUsedParticle = i;
-			return i;
-		}
-	}
-	// all particles are taken, override the first one (note that if it repeatedly hits this case, more particles should be reserved)
-	lastUsedParticle = 0;
-	return 0;
+	unsigned int bits = spawnRandom(this->seed, spawn);
+	float random = (static_cast<int>(bits % 100) - 50) / 10.0f;
+	float rColor = 0.5f + (((bits >> 16) % 100) / 100.0f);
+	glm::vec2 start = position + random + offset;
+	this->particles.PositionX[particle] = start.x;
+	this->particles.PositionY[particle] = start.y;
+	this->particles.VelocityX[particle] = velocity.x * 0.1f;
+	this->particles.VelocityY[particle] = velocity.y * 0.1f;
+	this->particles.R[particle] = rColor;
+	this->particles.G[particle] = rColor;
+	this->particles.B[particle] = rColor;
+	this->particles.A[particle] = 1.0f;
+	this->particles.Life[particle] = 1.0f;
 }
 
-void ParticleGenerator::respawnParticle(Particle &particle, GameObject &object, glm::vec2 offset)
+void ParticleGenerator::moveParticle(unsigned int from, unsigned int to)
 {
-	float random = ((rand() % 100) - 50) / 10.0f;
-	float rColor = 0.5f + ((rand() % 100) / 100.0f);
-	particle.Position = object.Position + random + offset;
-	particle.Color = glm::vec4(rColor, rColor, rColor, 1.0f);
-	particle.Life = 1.0f;
-	particle.Velocity = object.Velocity * 0.1f;
+	this->particles.PositionX[to] = this->particles.PositionX[from];
+	this->particles.PositionY[to] = this->particles.PositionY[from];
+	this->particles.VelocityX[to] = this->particles.VelocityX[from];
+	this->particles.VelocityY[to] = this->particles.VelocityY[from];
+	this->particles.R[to] = this->particles.R[from];
+	this->particles.G[to] = this->particles.G[from];
+	this->particles.B[to] = this->particles.B[from];
+	this->particles.A[to] = this->particles.A[from];
+	this->particles.Life[to] = this->particles.Life[from];
 }
\ No newline at end of file
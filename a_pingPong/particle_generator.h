@@ -1,5 +1,6 @@
 #ifndef PARTICLE_GENERATOR_H
 #define PARTICLE_GENERATOR_H
+#include <algorithm>
 #include <vector>
 
 #include <glad/glad.h>
@@ -7,45 +8,70 @@
 
 #include "shader.h"
 #include "texture.h"
-#include "game_object.h"
+#include "stream_buffer.h"
 
 
-// Represents a single particle and its state
-struct Particle {
-	glm::vec2 Position, Velocity;
-	glm::vec4 Color;
-	float     Life;
-
-	Particle() : Position(0.0f), Velocity(0.0f), Color(1.0f), Life(0.0f) { }
+// Particle state as structure-of-arrays: one float lane per attribute, each
+// 32-byte aligned and padded to a multiple of LANE_WIDTH, so the update
+// processes whole SIMD registers and never needs a scalar tail.
+struct ParticleLanes {
+	static const unsigned int LANE_WIDTH = 8;
+	float *PositionX, *PositionY;
+	float *VelocityX, *VelocityY;
+	float *R, *G, *B, *A;
+	float *Life;
 };
 
 
 // ParticleGenerator acts as a container for rendering a large number of 
 // particles by repeatedly spawning and updating particles and killing 
-// them after a given amount of time.
+// them after a given amount of time. Live particles are kept packed at the
+// front of the pool (a dying particle is swapped with the last live one),
+// so spawning is O(1) and update and draw only touch live particles.
 class ParticleGenerator
 {
 public:
-	// constructor
-	ParticleGenerator(Shader shader, Texture2D texture, unsigned int amount);
-	// update all particles
-	void Update(float dt, GameObject &object, unsigned int newParticles, glm::vec2 offset = glm::vec2(0.0f, 0.0f));
+	// constructor; particles are randomized from seed
+	ParticleGenerator(Shader shader, Texture2D texture, unsigned int amount, unsigned int seed = 0);
+	// spawns newParticles at the emitter position (plus offset) and velocity, then updates all particles;
+	// large pools are updated in parallel on the JobSystem, with the same result for any number of threads
+	void Update(float dt, glm::vec2 position, glm::vec2 velocity, unsigned int newParticles, glm::vec2 offset = glm::vec2(0.0f, 0.0f));
 	// render all particles
 	void Draw();
+	// draws one invisible particle, so the driver sets up the particle draw for the framebuffer
+	// bound now ahead of the first real one (which would otherwise allocate mid-game)
+	void Prime();
+	// number of particles currently alive
+	unsigned int LiveCount() const { return this->live; }
+	// caps the particles alive at once below the amount reserved; particles above a lowered
+	// limit live out their life, they just are not replaced
+	void SetLimit(unsigned int limit) { this->limit = std::min(limit, this->amount); }
 private:
-	// state
-	std::vector<Particle> particles;
+	// state; particles [0, live) of every lane are alive
+	ParticleLanes particles;
+	std::vector<float> storage;
 	unsigned int amount;
+	unsigned int limit;
+	unsigned int live;
+	unsigned int seed;
+	// particles spawned so far; numbers the random stream of each spawn
+	unsigned int spawned;
+	// per chunk of Update: the indices of the particles that died, and how many
+	std::vector<unsigned int> dead;
+	std::vector<unsigned int> deadCounts;
 	// render state
 	Shader shader;
 	Texture2D texture;
 	unsigned int VAO;
+	StreamBuffer instances;
 	// initializes buffer and vertex attributes
 	void init();
-	// returns the first Particle index that's currently unused e.g. Life <= 0.0f or 0 if no particle is currently inactive
-	unsigned int firstUnusedParticle();
-	// respawns particle
-	void respawnParticle(Particle &particle, GameObject &object, glm::vec2 offset = glm::vec2(0.0f, 0.0f));
+	// respawns particle as the spawn-th particle of this generator
+	void respawnParticle(unsigned int particle, unsigned int spawn, glm::vec2 position, glm::vec2 velocity, glm::vec2 offset);
+	// moves particle from into slot to
+	void moveParticle(unsigned int from, unsigned int to);
+	// draws count instances (offset, color) with additive blending
+	void drawInstances(const float *instanceData, unsigned int count);
 };
 
 #endif
\ No newline at end of file
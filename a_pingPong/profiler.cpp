@@ -0,0 +1,243 @@
+#include "profiler.h"
+
+#ifdef PINGPONG_PROFILE
+
+#include <glad/glad.h>
+
+#include "allocation_tracker.h"
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+
+// Instantiate static variables
+bool                             Profiler::running = false;
+bool                             Profiler::gpuEnabled = false;
+bool                             Profiler::gpuActive = false;
+unsigned int                     Profiler::depth = 0;
+unsigned int                     Profiler::frameIndex = 0;
+unsigned long long               Profiler::frameAllocations = 0;
+double                           Profiler::frameStart = 0.0;
+ProfileFrame                     Profiler::current;
+SpscQueue<ProfileFrame, 128>     Profiler::frames;
+unsigned int                     Profiler::queries[2][MAX_GPU_SCOPES];
+const char                      *Profiler::queryNames[2][MAX_GPU_SCOPES];
+double                           Profiler::queryStarts[2][MAX_GPU_SCOPES];
+unsigned int                     Profiler::queryCount[2];
+std::thread                      Profiler::collector;
+std::atomic<bool>                Profiler::collecting(false);
+std::atomic<float>               Profiler::p50(0.0f);
+std::atomic<float>               Profiler::p99(0.0f);
+std::atomic<float>               Profiler::gpuP50(0.0f);
+std::atomic<float>               Profiler::gpuP99(0.0f);
+std::atomic<unsigned int>        Profiler::maxAllocations(0);
+FILE                            *Profiler::trace = nullptr;
+
+static std::chrono::steady_clock::time_point epoch;
+
+void Profiler::Start(const char *traceFile, bool gpu)
+{
+	if (running)
+		return;
+	epoch = std::chrono::steady_clock::now();
+	if (traceFile)
+	{
+		trace = fopen(traceFile, "w");
+		if (!trace)
+			std::cout << "ERROR::PROFILER: Failed to open trace file " << traceFile << std::endl;
+		else
+			fputs("{\"traceEvents\":[\n"
+				"{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":1,\"args\":{\"name\":\"CPU\"}},\n"
+				"{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":2,\"args\":{\"name\":\"GPU\"}}", trace);
+	}
+	gpuEnabled = gpu;
+	gpuActive = false;
+	if (gpu)
+		glGenQueries(2 * MAX_GPU_SCOPES, &queries[0][0]);
+	queryCount[0] = queryCount[1] = 0;
+	depth = frameIndex = 0;
+	current.Index = 0;
+	current.Start = frameStart = 0.0;
+	current.GpuMs = 0.0f;
+	current.EventCount = 0;
+	running = true;
+	collecting = true;
+	collector = std::thread(collectLoop);
+}
+
+void Profiler::Stop()
+{
+	if (!running)
+		return;
+	running = false;
+	collecting = false;
+	collector.join();
+	if (gpuEnabled)
+		glDeleteQueries(2 * MAX_GPU_SCOPES, &queries[0][0]);
+	if (trace)
+	{
+		fputs("\n]}\n", trace);
+		fclose(trace);
+		trace = nullptr;
+	}
+}
+
+void Profiler::NewFrame()
+{
+	if (!running)
+		return;
+	double time = now();
+	unsigned long long allocations = AllocationTracker::ThreadAllocations();
+	if (frameIndex > 0)
+	{
+		current.FrameMs = static_cast<float>(time - frameStart);
+		current.Allocations = static_cast<unsigned int>(allocations - frameAllocations);
+		// the previous frame's queries have had a whole frame to finish
+		if (gpuEnabled)
+			resolveGpuScopes((frameIndex - 1) & 1);
+		// drop the frame rather than block when the collector falls behind
+		frames.Push(current);
+	}
+	++frameIndex;
+	current.Index = frameIndex;
+	current.Start = frameStart = time;
+	current.GpuMs = 0.0f;
+	current.EventCount = 0;
+	frameAllocations = allocations;
+	depth = 0;
+}
+
+unsigned int Profiler::BeginScope(const char *name)
+{
+	if (!running || current.EventCount == ProfileFrame::MAX_EVENTS)
+		return ProfileFrame::MAX_EVENTS;
+	ProfileEvent &event = current.Events[current.EventCount];
+	event.Name = name;
+	event.Start = now();
+	event.Duration = 0.0f;
+	event.Depth = static_cast<unsigned short>(depth++);
+	event.Gpu = 0;
+	return current.EventCount++;
+}
+
+void Profiler::EndScope(unsigned int event)
+{
+	if (event >= current.EventCount)
+		return;
+	current.Events[event].Duration = static_cast<float>(now() - current.Events[event].Start);
+	--depth;
+}
+
+bool Profiler::BeginGpuScope(const char *name)
+{
+	unsigned int set = frameIndex & 1;
+	if (!running || !gpuEnabled || gpuActive || queryCount[set] == MAX_GPU_SCOPES)
+		return false;
+	unsigned int query = queryCount[set];
+	queryNames[set][query] = name;
+	queryStarts[set][query] = now();
+	glBeginQuery(GL_TIME_ELAPSED, queries[set][query]);
+	gpuActive = true;
+	return true;
+}
+
+void Profiler::EndGpuScope()
+{
+	glEndQuery(GL_TIME_ELAPSED);
+	++queryCount[frameIndex & 1];
+	gpuActive = false;
+}
+
+FrameStats Profiler::Stats()
+{
+	FrameStats stats = { p50.load(std::memory_order_relaxed), p99.load(std::memory_order_relaxed),
+		gpuP50.load(std::memory_order_relaxed), gpuP99.load(std::memory_order_relaxed),
+		maxAllocations.load(std::memory_order_relaxed) };
+	return stats;
+}
+
+double Profiler::now()
+{
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - epoch).count();
+}
+
+void Profiler::resolveGpuScopes(unsigned int set)
+{
+	unsigned int count = queryCount[set];
+	queryCount[set] = 0;
+	if (count == 0)
+		return;
+	// queries complete in order: if the last one is not done, skip the frame instead of stalling
+	GLint available = 0;
+	glGetQueryObjectiv(queries[set][count - 1], GL_QUERY_RESULT_AVAILABLE, &available);
+	if (!available)
+		return;
+	for (unsigned int i = 0; i < count; ++i)
+	{
+		GLuint64 elapsed = 0;
+		glGetQueryObjectui64v(queries[set][i], GL_QUERY_RESULT, &elapsed);
+		float ms = static_cast<float>(elapsed / 1.0e6);
+		current.GpuMs += ms;
+		if (current.EventCount == ProfileFrame::MAX_EVENTS)
+			continue;
+		ProfileEvent &event = current.Events[current.EventCount++];
+		event.Name = queryNames[set][i];
+		event.Start = queryStarts[set][i];
+		event.Duration = ms;
+		event.Depth = 0;
+		event.Gpu = 1;
+	}
+}
+
+// value below which the given fraction of the samples fall
+static float percentile(const float *samples, unsigned int count, float fraction, float *scratch)
+{
+	std::copy(samples, samples + count, scratch);
+	unsigned int nth = static_cast<unsigned int>(fraction * (count - 1) + 0.5f);
+	std::nth_element(scratch, scratch + nth, scratch + count);
+	return scratch[nth];
+}
+
+void Profiler::collectLoop()
+{
+	float frameTimes[WINDOW], gpuTimes[WINDOW], scratch[WINDOW];
+	unsigned int allocations[WINDOW];
+	unsigned int count = 0;
+	ProfileFrame frame;
+	for (;;)
+	{
+		if (!frames.Pop(frame))
+		{
+			if (!collecting)
+				return;
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+			continue;
+		}
+		frameTimes[count % WINDOW] = frame.FrameMs;
+		gpuTimes[count % WINDOW] = frame.GpuMs;
+		allocations[count % WINDOW] = frame.Allocations;
+		++count;
+		unsigned int samples = count < WINDOW ? count : WINDOW;
+		maxAllocations.store(*std::max_element(allocations, allocations + samples), std::memory_order_relaxed);
+		p50.store(percentile(frameTimes, samples, 0.50f, scratch), std::memory_order_relaxed);
+		p99.store(percentile(frameTimes, samples, 0.99f, scratch), std::memory_order_relaxed);
+		gpuP50.store(percentile(gpuTimes, samples, 0.50f, scratch), std::memory_order_relaxed);
+		gpuP99.store(percentile(gpuTimes, samples, 0.99f, scratch), std::memory_order_relaxed);
+		if (!trace)
+			continue;
+		// Chrome trace events use microseconds
+		fprintf(trace, ",\n{\"name\":\"Frame %u\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":1}",
+			frame.Index, frame.Start * 1000.0, frame.FrameMs * 1000.0);
+		if (AllocationTracker::Enabled())
+			fprintf(trace, ",\n{\"name\":\"Allocations\",\"ph\":\"C\",\"ts\":%.3f,\"pid\":1,\"args\":{\"count\":%u}}",
+				frame.Start * 1000.0, frame.Allocations);
+		for (unsigned int i = 0; i < frame.EventCount; ++i)
+		{
+			const ProfileEvent &event = frame.Events[i];
+			fprintf(trace, ",\n{\"name\":\"%s\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":%d}",
+				event.Name, event.Start * 1000.0, event.Duration * 1000.0, event.Gpu ? 2 : 1);
+		}
+	}
+}
+
+#endif
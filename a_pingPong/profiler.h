@@ -0,0 +1,131 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+// Instrumentation macros; without PINGPONG_PROFILE they expand to nothing,
+// so shipping builds pay nothing for the scopes left in the code.
+//   PROFILE_FRAME()          marks the start of a new frame (once per loop iteration)
+//   PROFILE_SCOPE(name)      times the CPU until the end of the enclosing block
+//   PROFILE_GPU_SCOPE(name)  also times the GL commands issued in the block
+#ifdef PINGPONG_PROFILE
+
+#include <atomic>
+#include <cstdio>
+#include <thread>
+
+#include "spsc_queue.h"
+
+#define PROFILE_CONCAT_(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_(a, b)
+#define PROFILE_FRAME() Profiler::NewFrame()
+#define PROFILE_SCOPE(name) ProfileScope PROFILE_CONCAT(profileScope, __LINE__)(name)
+#define PROFILE_GPU_SCOPE(name) GpuProfileScope PROFILE_CONCAT(profileScope, __LINE__)(name)
+
+// One timed scope: CPU scopes nest (Depth), GPU scopes are measured with
+// GL_TIME_ELAPSED queries and placed at the CPU time they were issued.
+struct ProfileEvent {
+	const char     *Name;
+	double          Start;    // ms since Profiler::Start
+	float           Duration; // ms
+	unsigned short  Depth;
+	unsigned short  Gpu;
+};
+
+// Everything recorded for one frame. GPU results arrive a frame late (so
+// reading them never stalls) and are reported with the frame that read them.
+struct ProfileFrame {
+	static const unsigned int MAX_EVENTS = 48;
+	unsigned int Index;
+	double       Start;    // ms since Profiler::Start
+	float        FrameMs;  // start of this frame to start of the next
+	float        GpuMs;    // sum of the GPU scopes of the previous frame
+	unsigned int Allocations; // heap allocations on the game thread (PINGPONG_TRACK_ALLOCATIONS builds)
+	unsigned int EventCount;
+	ProfileEvent Events[MAX_EVENTS];
+};
+
+// Frame-time percentiles over the last Profiler::WINDOW frames
+struct FrameStats {
+	float        P50, P99, GpuP50, GpuP99;
+	unsigned int MaxAllocations;
+};
+
+
+// Profiler records scopes on the game thread into a per-frame record that
+// is pushed through a lock-free ring buffer to a collector thread, which
+// keeps the percentile statistics and optionally streams the frames to a
+// Chrome trace (chrome://tracing, https://ui.perfetto.dev). All functions
+// are static and must be called from the thread that owns the GL context.
+class Profiler
+{
+public:
+	// frames kept for the percentile statistics
+	static const unsigned int WINDOW = 240;
+	// starts the collector; traceFile may be null, gpu needs a current GL context
+	static void Start(const char *traceFile, bool gpu);
+	// flushes the trace and stops the collector
+	static void Stop();
+	// finishes the current frame record and starts the next one
+	static void NewFrame();
+	// scope bookkeeping; use the PROFILE_ macros rather than calling these
+	static unsigned int BeginScope(const char *name);
+	static void EndScope(unsigned int event);
+	static bool BeginGpuScope(const char *name);
+	static void EndGpuScope();
+	// latest published statistics (updated by the collector thread)
+	static FrameStats Stats();
+private:
+	static const unsigned int MAX_GPU_SCOPES = 16;
+	static bool                             running, gpuEnabled, gpuActive;
+	static unsigned int                     depth, frameIndex;
+	static unsigned long long               frameAllocations;
+	static double                           frameStart;
+	static ProfileFrame                     current;
+	static SpscQueue<ProfileFrame, 128>     frames;
+	// two query sets: one is issued this frame while the other is read back
+	static unsigned int                     queries[2][MAX_GPU_SCOPES];
+	static const char                      *queryNames[2][MAX_GPU_SCOPES];
+	static double                           queryStarts[2][MAX_GPU_SCOPES];
+	static unsigned int                     queryCount[2];
+	// collector thread state
+	static std::thread                      collector;
+	static std::atomic<bool>                collecting;
+	static std::atomic<float>               p50, p99, gpuP50, gpuP99;
+	static std::atomic<unsigned int>        maxAllocations;
+	static FILE                            *trace;
+	// milliseconds since Start
+	static double now();
+	static void resolveGpuScopes(unsigned int set);
+	static void collectLoop();
+	Profiler() { }
+};
+
+// RAII CPU scope
+class ProfileScope
+{
+public:
+	explicit ProfileScope(const char *name) : event(Profiler::BeginScope(name)) { }
+	~ProfileScope() { Profiler::EndScope(this->event); }
+private:
+	unsigned int event;
+};
+
+// RAII CPU + GPU scope; GPU scopes cannot nest, inner ones only time the CPU
+class GpuProfileScope
+{
+public:
+	explicit GpuProfileScope(const char *name) : cpu(name), gpu(Profiler::BeginGpuScope(name)) { }
+	~GpuProfileScope() { if (this->gpu) Profiler::EndGpuScope(); }
+private:
+	ProfileScope cpu;
+	bool         gpu;
+};
+
+#else
+
+#define PROFILE_FRAME() ((void)0)
+#define PROFILE_SCOPE(name) ((void)0)
+#define PROFILE_GPU_SCOPE(name) ((void)0)
+
+#endif
+
+#endif
@@ -0,0 +1,78 @@
+#include "quality_governor.h"
+
+#include <algorithm>
+#include <chrono>
+
+// a window steps down when its median misses the budget or its 90th percentile misses it by this much
+const float DOWN_TOLERANCE = 1.1f;
+// and is calm (counts towards stepping up) when its 90th percentile is within this fraction of the budget
+const float UP_HEADROOM = 0.7f;
+// calm windows needed to step up, at first and at most
+const unsigned int MIN_UPGRADE_WINDOWS = 2;
+const unsigned int MAX_UPGRADE_WINDOWS = 32;
+
+// a lower resolution costs sharpness everywhere, so the particles go first
+const QualityTier QualityGovernor::TIERS[] = {
+	{ "minimal", 0.0f,  0.5f },
+	{ "low",     0.25f, 0.5f },
+	{ "medium",  0.5f,  1.0f },
+	{ "high",    1.0f,  1.0f },
+	{ "ultra",   2.0f,  1.0f },
+	{ "max",     4.0f,  1.0f },
+};
+const unsigned int QualityGovernor::TIER_COUNT = sizeof(TIERS) / sizeof(TIERS[0]);
+const unsigned int QualityGovernor::DEFAULT_TIER = 3;
+
+QualityGovernor::QualityGovernor(float budgetMs)
+	: BudgetMs(budgetMs), WindowFrames(120), Tier(DEFAULT_TIER),
+	  lastFrame(0.0), calmWindows(0), upgradeWindows(MIN_UPGRADE_WINDOWS), upgraded(false)
+{
+	this->frameMs.reserve(this->WindowFrames);
+}
+
+float QualityGovernor::MaxParticles()
+{
+	float largest = 0.0f;
+	for (unsigned int i = 0; i < TIER_COUNT; ++i)
+		largest = std::max(largest, TIERS[i].Particles);
+	return largest;
+}
+
+bool QualityGovernor::Frame()
+{
+	double now = std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+	if (this->lastFrame > 0.0)
+		this->frameMs.push_back(static_cast<float>((now - this->lastFrame) * 1000.0));
+	this->lastFrame = now;
+	if (this->frameMs.size() < std::max(1u, this->WindowFrames))
+		return false;
+	// sorting a window every couple of seconds is cheap; the vector keeps its capacity
+	std::sort(this->frameMs.begin(), this->frameMs.end());
+	float p50 = this->frameMs[this->frameMs.size() / 2];
+	float p90 = this->frameMs[this->frameMs.size() * 9 / 10];
+	this->frameMs.clear();
+	bool upgraded = this->upgraded;
+	this->upgraded = false;
+	if (p50 > this->BudgetMs || p90 > this->BudgetMs * DOWN_TOLERANCE)
+	{
+		this->calmWindows = 0;
+		if (this->Tier == 0)
+			return false;
+		// the tier just stepped up to did not fit: wait longer before trying it again
+		if (upgraded)
+			this->upgradeWindows = std::min(this->upgradeWindows * 2, MAX_UPGRADE_WINDOWS);
+		--this->Tier;
+		return true;
+	}
+	if (p90 > this->BudgetMs * UP_HEADROOM)
+	{
+		this->calmWindows = 0;
+		return false;
+	}
+	if (++this->calmWindows < this->upgradeWindows || this->Tier + 1 >= TIER_COUNT)
+		return false;
+	this->calmWindows = 0;
+	this->upgraded = true;
+	++this->Tier;
+	return true;
+}
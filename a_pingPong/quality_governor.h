@@ -0,0 +1,52 @@
+#ifndef QUALITY_GOVERNOR_H
+#define QUALITY_GOVERNOR_H
+
+#include <vector>
+
+// One step of the quality ladder
+struct QualityTier {
+	const char *Name;
+	float       Particles;   // multiple of Game::ParticleCount spawned and kept in the pool; 0 turns the trail off
+	float       Resolution;  // fraction of the window's resolution the scene is rendered at
+};
+
+
+// QualityGovernor keeps frames within a frame-time budget by stepping
+// through the quality tiers. It times the interval between its Frame calls
+// and judges windows of WindowFrames frames by their percentiles: a window
+// whose median or 90th percentile misses the budget steps down one tier
+// right away, while stepping up takes several windows in a row with a 90th
+// percentile well under the budget. The gap between the two thresholds and
+// the delay keep it from oscillating between tiers; a step up that is
+// undone in the next window doubles the delay before the next attempt.
+class QualityGovernor
+{
+public:
+	// the tiers from lowest to highest quality
+	static const QualityTier    TIERS[];
+	static const unsigned int   TIER_COUNT;
+	// tier the game starts at: the configured particle count at native resolution
+	static const unsigned int   DEFAULT_TIER;
+	// frame time (ms) to stay within
+	float        BudgetMs;
+	// frames per measurement window
+	unsigned int WindowFrames;
+	// index of the current tier in TIERS
+	unsigned int Tier;
+	// constructor
+	QualityGovernor(float budgetMs);
+	// call once per frame; true if Tier changed
+	bool Frame();
+	// the current tier
+	const QualityTier &Current() const { return TIERS[this->Tier]; }
+	// the highest particle multiple of any tier, for sizing the particle pool
+	static float MaxParticles();
+private:
+	double             lastFrame;        // when the previous frame started, in seconds
+	std::vector<float> frameMs;          // frame times of the current window
+	unsigned int       calmWindows;      // windows in a row with room to step up
+	unsigned int       upgradeWindows;   // calm windows needed to step up
+	bool               upgraded;         // the last window stepped up
+};
+
+#endif
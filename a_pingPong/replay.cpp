@@ -0,0 +1,95 @@
+#include "replay.h"
+
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+
+#include "game.h"
+
+// the keys the game reacts to, in bit order
+static const int REPLAY_KEYS[] = {
+	GLFW_KEY_UP, GLFW_KEY_DOWN, GLFW_KEY_W, GLFW_KEY_S, GLFW_KEY_SPACE,
+	GLFW_KEY_ENTER, GLFW_KEY_LEFT, GLFW_KEY_RIGHT, GLFW_KEY_A, GLFW_KEY_D
+};
+static const unsigned int REPLAY_KEY_COUNT = sizeof(REPLAY_KEYS) / sizeof(REPLAY_KEYS[0]);
+// version 2 added the flags word after the seed, version 3 the ball count after the flags
+static const unsigned int REPLAY_VERSION = 3;
+static const unsigned int REPLAY_FIXED_POINT = 1;
+
+bool Replay::Load(const char *file)
+{
+	FILE *in = fopen(file, "rb");
+	if (!in)
+	{
+		std::cout << "ERROR::REPLAY: Failed to open " << file << std::endl;
+		return false;
+	}
+	char magic[4];
+	unsigned int version = 0, flags = 0, balls = 1, count = 0;
+	bool ok = fread(magic, 1, 4, in) == 4 && memcmp(magic, "PPRP", 4) == 0
+		&& fread(&version, 4, 1, in) == 1 && version >= 1 && version <= REPLAY_VERSION
+		&& fread(&this->Seed, 4, 1, in) == 1 && (version < 2 || fread(&flags, 4, 1, in) == 1)
+		&& (version < 3 || (fread(&balls, 4, 1, in) == 1 && balls >= 1))
+		&& fread(&count, 4, 1, in) == 1;
+	this->FixedPoint = (flags & REPLAY_FIXED_POINT) != 0;
+	this->BallCount = balls;
+	if (ok)
+	{
+		this->Frames.resize(count);
+		ok = count == 0 || fread(&this->Frames[0], sizeof(ReplayFrame), count, in) == count;
+	}
+	fclose(in);
+	if (!ok)
+		std::cout << "ERROR::REPLAY: Not a valid replay file: " << file << std::endl;
+	return ok;
+}
+
+bool Replay::Save(const char *file) const
+{
+	FILE *out = fopen(file, "wb");
+	if (!out)
+	{
+		std::cout << "ERROR::REPLAY: Failed to open " << file << std::endl;
+		return false;
+	}
+	unsigned int count = static_cast<unsigned int>(this->Frames.size());
+	unsigned int flags = this->FixedPoint ? REPLAY_FIXED_POINT : 0;
+	fwrite("PPRP", 1, 4, out);
+	fwrite(&REPLAY_VERSION, 4, 1, out);
+	fwrite(&this->Seed, 4, 1, out);
+	fwrite(&flags, 4, 1, out);
+	fwrite(&this->BallCount, 4, 1, out);
+	fwrite(&count, 4, 1, out);
+	if (count)
+		fwrite(&this->Frames[0], sizeof(ReplayFrame), count, out);
+	fclose(out);
+	return true;
+}
+
+unsigned short Replay::HeldKeys(const Game &game)
+{
+	unsigned short held = 0;
+	for (unsigned int i = 0; i < REPLAY_KEY_COUNT; ++i)
+		if (game.Keys[REPLAY_KEYS[i]])
+			held |= 1 << i;
+	return held;
+}
+
+unsigned short Replay::KeyBit(int key)
+{
+	for (unsigned int i = 0; i < REPLAY_KEY_COUNT; ++i)
+		if (REPLAY_KEYS[i] == key)
+			return 1 << i;
+	return 0;
+}
+
+void Replay::Apply(Game &game, const ReplayFrame &frame)
+{
+	for (unsigned int i = 0; i < REPLAY_KEY_COUNT; ++i)
+	{
+		int key = REPLAY_KEYS[i];
+		if (frame.Released & (1 << i))
+			game.KeysProcessed[key] = false;
+		game.Keys[key] = (frame.Held & (1 << i)) != 0;
+	}
+}
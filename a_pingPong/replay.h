@@ -0,0 +1,44 @@
+#ifndef REPLAY_H
+#define REPLAY_H
+
+#include <vector>
+
+class Game;
+
+// One recorded frame of input: the time step the frame was simulated with,
+// the game keys held while it was processed and the keys released since
+// the previous frame (a press and release inside one frame still resets
+// KeysProcessed, exactly as key_callback does).
+struct ReplayFrame {
+	float          Dt;
+	unsigned short Held;
+	unsigned short Released;
+};
+
+
+// Replay stores everything needed to re-simulate a match bit for bit:
+// the random seed (particles), whether the physics ran in fixed point, the
+// number of balls in play and the per-frame input. Files are small and binary ("PPRP" header followed
+// by the frames).
+class Replay
+{
+public:
+	// state
+	unsigned int             Seed;
+	bool                     FixedPoint;
+	unsigned int             BallCount;
+	std::vector<ReplayFrame> Frames;
+	// constructor
+	Replay() : Seed(0), FixedPoint(false), BallCount(1) { }
+	// loads/saves the replay file; return false (and print an error) on failure
+	bool Load(const char *file);
+	bool Save(const char *file) const;
+	// packs the game keys currently held into a bitmask
+	static unsigned short HeldKeys(const Game &game);
+	// returns the bit for a GLFW key, or 0 if the game does not use that key
+	static unsigned short KeyBit(int key);
+	// applies a recorded frame's input to the game's key state
+	static void Apply(Game &game, const ReplayFrame &frame);
+};
+
+#endif
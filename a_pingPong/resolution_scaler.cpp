@@ -0,0 +1,110 @@
+#include "resolution_scaler.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+
+#include <glad/glad.h>
+
+// Govern leaves Scale alone while the frame time is within this fraction below the target
+const float HEADROOM = 0.85f;
+// smallest change of Scale worth a step
+const float MIN_STEP = 0.02f;
+
+ResolutionScaler::ResolutionScaler(Shader shader)
+	: Scale(1.0f), MinScale(0.5f), TargetMs(1000.0f / 60.0f), SettleFrames(60),
+	  shader(shader), framebuffer(0), texture(0), vertexArray(0), width(0), height(0), output(), outputFramebuffer(0),
+	  sceneWidth(0), sceneHeight(0), lastFrame(0.0)
+{
+	this->frameMs.reserve(this->SettleFrames);
+}
+
+ResolutionScaler::~ResolutionScaler()
+{
+	if (this->framebuffer)
+	{
+		glDeleteFramebuffers(1, &this->framebuffer);
+		glDeleteTextures(1, &this->texture);
+		glDeleteVertexArrays(1, &this->vertexArray);
+	}
+}
+
+void ResolutionScaler::Begin()
+{
+	glGetIntegerv(GL_VIEWPORT, this->output);
+	glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &this->outputFramebuffer);
+	// (re)create the framebuffer when the output outgrows it
+	if (this->output[2] > this->width || this->output[3] > this->height)
+	{
+		if (!this->framebuffer)
+		{
+			glGenFramebuffers(1, &this->framebuffer);
+			glGenTextures(1, &this->texture);
+			// the upscale triangle has no vertex data, but core profiles draw only with a vertex array bound
+			glGenVertexArrays(1, &this->vertexArray);
+		}
+		this->width = std::max(this->width, this->output[2]);
+		this->height = std::max(this->height, this->output[3]);
+		glBindTexture(GL_TEXTURE_2D, this->texture);
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, this->width, this->height, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+		glBindFramebuffer(GL_FRAMEBUFFER, this->framebuffer);
+		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, this->texture, 0);
+		if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+			std::cout << "ERROR::RESOLUTION_SCALER: Framebuffer is not complete" << std::endl;
+	}
+	this->sceneWidth = std::max(1, static_cast<int>(std::lround(this->output[2] * this->Scale)));
+	this->sceneHeight = std::max(1, static_cast<int>(std::lround(this->output[3] * this->Scale)));
+	glBindFramebuffer(GL_FRAMEBUFFER, this->framebuffer);
+	// the scene's projection is in game units, so only the viewport shrinks
+	glViewport(0, 0, this->sceneWidth, this->sceneHeight);
+	// the background covers everything, but a cleared framebuffer spares tiled rasterizers
+	// (llvmpipe, mobile GPUs) reading the previous frame back in
+	glClear(GL_COLOR_BUFFER_BIT);
+}
+
+void ResolutionScaler::End()
+{
+	glBindFramebuffer(GL_FRAMEBUFFER, this->outputFramebuffer);
+	glViewport(this->output[0], this->output[1], this->output[2], this->output[3]);
+	// the scene is opaque: copy it rather than blend it over the output
+	GLboolean blend = glIsEnabled(GL_BLEND);
+	glDisable(GL_BLEND);
+	this->shader.Use();
+	this->shader.SetVector2f("sceneSize", static_cast<float>(this->sceneWidth) / this->width,
+		static_cast<float>(this->sceneHeight) / this->height);
+	this->shader.SetVector2f("limit", (this->sceneWidth - 0.5f) / this->width, (this->sceneHeight - 0.5f) / this->height);
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_2D, this->texture);
+	glBindVertexArray(this->vertexArray);
+	glDrawArrays(GL_TRIANGLES, 0, 3);
+	glBindVertexArray(0);
+	if (blend)
+		glEnable(GL_BLEND);
+}
+
+void ResolutionScaler::Govern()
+{
+	double now = std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+	if (this->lastFrame > 0.0)
+		this->frameMs.push_back(static_cast<float>((now - this->lastFrame) * 1000.0));
+	this->lastFrame = now;
+	if (this->frameMs.size() < std::max(1u, this->SettleFrames))
+		return;
+	// the median ignores the odd stall; the vector keeps its capacity, so steady-state frames do not allocate
+	std::nth_element(this->frameMs.begin(), this->frameMs.begin() + this->frameMs.size() / 2, this->frameMs.end());
+	float median = this->frameMs[this->frameMs.size() / 2];
+	this->frameMs.clear();
+	// within the band, including a frame held to the target by vsync, nothing changes
+	if (median <= this->TargetMs && median >= this->TargetMs * HEADROOM)
+		return;
+	// aim for the middle of the band: pixels, and so their cost, scale with Scale squared
+	float scale = this->Scale * std::sqrt(this->TargetMs * (1.0f + HEADROOM) / 2.0f / median);
+	scale = std::min(1.0f, std::max(this->MinScale, scale));
+	if (std::fabs(scale - this->Scale) >= MIN_STEP)
+		this->Scale = scale;
+}
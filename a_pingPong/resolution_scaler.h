@@ -0,0 +1,53 @@
+#ifndef RESOLUTION_SCALER_H
+#define RESOLUTION_SCALER_H
+
+#include <vector>
+
+#include "shader.h"
+
+// ResolutionScaler renders the scene at a fraction of the output resolution
+// and stretches it to the output, trading sharpness for fill rate (what a
+// software rasterizer such as llvmpipe runs out of first). Begin redirects
+// drawing into the corner of an offscreen framebuffer that matches Scale,
+// End stretches that corner over the whole viewport with linear filtering
+// (a textured triangle: llvmpipe's scaled blits are slower than drawing);
+// what is drawn after End (the text) stays at native resolution. The
+// framebuffer is sized for the full viewport, so changing Scale never
+// reallocates it. Govern steers Scale to the target frame time, measured
+// as the median interval between Begin calls over SettleFrames frames.
+class ResolutionScaler
+{
+public:
+	// fraction of the output resolution per axis the scene is rendered at
+	float        Scale;
+	// lowest Scale Govern goes down to
+	float        MinScale;
+	// frame time (ms) Govern aims for
+	float        TargetMs;
+	// frames Govern measures between changes, so the measurement reflects the last one
+	unsigned int SettleFrames;
+	// constructor/destructor; shader is the upscale shader
+	ResolutionScaler(Shader shader);
+	~ResolutionScaler();
+	// redirects drawing into the scaled framebuffer; the viewport in place is the output
+	void Begin();
+	// upscales the scene to the output and restores its framebuffer and viewport
+	void End();
+	// call once per frame before Begin: times the frame and, once SettleFrames are
+	// measured, adjusts Scale; the cost of filling pixels grows with the square of Scale
+	void Govern();
+	// owns GL objects, so it cannot be copied
+	ResolutionScaler(const ResolutionScaler&) = delete;
+	ResolutionScaler &operator=(const ResolutionScaler&) = delete;
+private:
+	Shader       shader;
+	unsigned int framebuffer, texture, vertexArray;
+	int          width, height;        // size of the framebuffer
+	int          output[4];            // viewport and framebuffer to restore in End
+	int          outputFramebuffer;
+	int          sceneWidth, sceneHeight;
+	double       lastFrame;            // when the previous frame started, in seconds
+	std::vector<float> frameMs;        // frame times since the last change
+};
+
+#endif
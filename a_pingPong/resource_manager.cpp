@@ -2,8 +2,10 @@
 
 #include <iostream>
 #include <sstream>
+#include <vector>
 #include <fstream>
 
+#include "job_system.h"
 #include "stb_image.h"
 
 // Instantiate static variables
@@ -17,6 +19,20 @@ Shader ResourceManager::LoadShader(const char *vShaderFile, const char *fShaderF
 	return Shaders[name];
 }
 
+Shader ResourceManager::LoadTransformFeedbackShader(const char *vShaderFile, const char *const *varyings, int varyingCount, std::string name)
+{
+	std::ifstream vertexShaderFile(vShaderFile);
+	if (!vertexShaderFile)
+		std::cout << "ERROR::SHADER: Failed to read shader file " << vShaderFile << std::endl;
+	std::stringstream vShaderStream;
+	vShaderStream << vertexShaderFile.rdbuf();
+	std::string vertexCode = vShaderStream.str();
+	Shader shader;
+	shader.CompileTransformFeedback(vertexCode.c_str(), varyings, varyingCount);
+	Shaders[name] = shader;
+	return shader;
+}
+
 Shader ResourceManager::GetShader(std::string name)
 {
 	return Shaders[name];
@@ -28,6 +44,33 @@ Texture2D ResourceManager::LoadTexture(const char *file, bool alpha, std::string
 	return Textures[name];
 }
 
+void ResourceManager::LoadTextures(const TextureFile *files, unsigned int count)
+{
+	// decoding is the slow part and needs no GL context, so it runs on the workers
+	struct Image { unsigned char *Data; int Width, Height; };
+	std::vector<Image> images(count);
+	JobSystem::ParallelFor(count, 1, [&](unsigned int begin, unsigned int end) {
+		for (unsigned int i = begin; i < end; ++i)
+		{
+			int nrChannels;
+			images[i].Data = stbi_load(files[i].File, &images[i].Width, &images[i].Height, &nrChannels, 0);
+		}
+	});
+	// then upload on this thread, which owns the context
+	for (unsigned int i = 0; i < count; ++i)
+	{
+		Texture2D texture;
+		if (files[i].Alpha)
+		{
+			texture.Internal_Format = GL_RGBA;
+			texture.Image_Format = GL_RGBA;
+		}
+		texture.Generate(images[i].Width, images[i].Height, images[i].Data);
+		stbi_image_free(images[i].Data);
+		Textures[files[i].Name] = texture;
+	}
+}
+
 Texture2D ResourceManager::GetTexture(std::string name)
 {
 	return Textures[name];
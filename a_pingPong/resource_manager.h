@@ -10,6 +10,13 @@
 #include "shader.h"
 
 
+// One texture to load with ResourceManager::LoadTextures
+struct TextureFile {
+	const char *File;
+	bool        Alpha;
+	const char *Name;
+};
+
 // A static singleton ResourceManager class that hosts several
 // functions to load Textures and Shaders. Each loaded texture
 // and/or shader is also stored for future reference by string
@@ -23,10 +30,14 @@ public:
 	static std::map<std::string, Texture2D> Textures;
 	// loads (and generates) a shader program from file loading vertex, fragment (and geometry) shader's source code. If gShaderFile is not nullptr, it also loads a geometry shader
 	static Shader    LoadShader(const char *vShaderFile, const char *fShaderFile, const char *gShaderFile, std::string name);
+	// loads a vertex-only shader program whose outputs (varyings) are captured with transform feedback
+	static Shader    LoadTransformFeedbackShader(const char *vShaderFile, const char *const *varyings, int varyingCount, std::string name);
 	// retrieves a stored sader
 	static Shader    GetShader(std::string name);
 	// loads (and generates) a texture from file
 	static Texture2D LoadTexture(const char *file, bool alpha, std::string name);
+	// loads several textures, decoding the image files in parallel on the JobSystem
+	static void      LoadTextures(const TextureFile *files, unsigned int count);
 	// retrieves a stored texture
 	static Texture2D GetTexture(std::string name);
 	// properly de-allocates all loaded resources
@@ -44,6 +44,21 @@ void Shader::Compile(const char* vertexSource, const char* fragmentSource, const
 		glDeleteShader(gShader);
 }
 
+void Shader::CompileTransformFeedback(const char *vertexSource, const char *const *varyings, int varyingCount)
+{
+	unsigned int sVertex = glCreateShader(GL_VERTEX_SHADER);
+	glShaderSource(sVertex, 1, &vertexSource, NULL);
+	glCompileShader(sVertex);
+	checkCompileErrors(sVertex, "VERTEX");
+	// the captured outputs must be declared before linking
+	this->ID = glCreateProgram();
+	glAttachShader(this->ID, sVertex);
+	glTransformFeedbackVaryings(this->ID, varyingCount, varyings, GL_INTERLEAVED_ATTRIBS);
+	glLinkProgram(this->ID);
+	checkCompileErrors(this->ID, "PROGRAM");
+	glDeleteShader(sVertex);
+}
+
 void Shader::SetFloat(const char *name, float value, bool useShader)
 {
 	if (useShader)
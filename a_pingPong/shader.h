@@ -22,6 +22,8 @@ public:
 	Shader  &Use();
 	// compiles the shader from given source code
 	void    Compile(const char *vertexSource, const char *fragmentSource, const char *geometrySource = nullptr); // note: geometry source code is optional 
+	// compiles a vertex-only program whose outputs are captured, interleaved, with transform feedback
+	void    CompileTransformFeedback(const char *vertexSource, const char *const *varyings, int varyingCount);
 																												 // utility functions
 	void    SetFloat(const char *name, float value, bool useShader = false);
 	void    SetInteger(const char *name, int value, bool useShader = false);
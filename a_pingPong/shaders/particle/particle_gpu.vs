@@ -0,0 +1,22 @@
+#version 330 core
+layout (location = 0) in vec4 vertex; // <vec2 position, vec2 texCoords>
+layout (location = 1) in vec2 offset; // per instance, straight from the particle state buffer
+layout (location = 2) in vec4 color;  // per instance
+layout (location = 3) in float life;  // per instance
+
+out vec2 TexCoords;
+out vec4 ParticleColor;
+
+uniform mat4 projection;
+
+void main()
+{
+    float scale = 10.0f;
+    TexCoords = vertex.zw;
+    ParticleColor = color;
+    // dead particles are still instanced; move them behind the near plane so they are clipped
+    if (life <= 0.0)
+        gl_Position = vec4(0.0, 0.0, -2.0, 1.0);
+    else
+        gl_Position = projection * vec4((vertex.xy * scale) + offset, 0.0, 1.0);
+}
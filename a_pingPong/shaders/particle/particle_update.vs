@@ -0,0 +1,60 @@
+#version 330 core
+// Advances one particle per vertex; the outputs are captured with transform
+// feedback into the other state buffer (see GpuParticleGenerator).
+layout (location = 0) in vec2 position;
+layout (location = 1) in vec2 velocity;
+layout (location = 2) in vec4 color;
+layout (location = 3) in float life;
+
+out vec2 outPosition;
+out vec2 outVelocity;
+out vec4 outColor;
+out float outLife;
+
+uniform float dt;
+uniform int amount;
+// this frame's spawn batch: spawnCount slots starting at spawnStart (wrapping)
+uniform int spawnStart;
+uniform int spawnCount;
+uniform int seed;
+// emitter parameters, derived from the object the particles follow
+uniform vec2 emitterPosition;
+uniform vec2 emitterVelocity;
+
+// integer hash (lowbias32), one independent random number per particle and frame
+uint hash(uint x)
+{
+    x ^= x >> 16;
+    x *= 0x7feb352du;
+    x ^= x >> 15;
+    x *= 0x846ca68bu;
+    x ^= x >> 16;
+    return x;
+}
+
+void main()
+{
+    outPosition = position;
+    outVelocity = velocity;
+    outColor = color;
+    outLife = life;
+    // respawn the slots of this frame's batch, like ParticleGenerator::respawnParticle
+    int slot = (gl_VertexID - spawnStart + amount) % amount;
+    if (slot < spawnCount)
+    {
+        uint h = hash(uint(gl_VertexID) ^ hash(uint(seed)));
+        float random = float(int(h % 100u) - 50) / 10.0;
+        float rColor = 0.5 + float((h >> 16) % 100u) / 100.0;
+        outPosition = emitterPosition + random;
+        outVelocity = emitterVelocity * 0.1;
+        outColor = vec4(rColor, rColor, rColor, 1.0);
+        outLife = 1.0;
+    }
+    // then update it
+    outLife -= dt;
+    if (outLife > 0.0)
+    {
+        outPosition -= outVelocity * dt;
+        outColor.a -= dt * 2.5;
+    }
+}
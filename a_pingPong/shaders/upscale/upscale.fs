@@ -0,0 +1,13 @@
+#version 330 core
+in vec2 TexCoords;
+out vec4 color;
+
+// the scene fills the fraction sceneSize of the texture; limit keeps the filter from reading past it
+uniform sampler2D scene;
+uniform vec2 sceneSize;
+uniform vec2 limit;
+
+void main()
+{
+    color = vec4(texture(scene, min(TexCoords * sceneSize, limit)).rgb, 1.0);
+}
@@ -0,0 +1,52 @@
+#ifndef SPSC_QUEUE_H
+#define SPSC_QUEUE_H
+
+#include <atomic>
+
+
+// SpscQueue is a fixed-capacity, lock-free ring buffer that is safe to use
+// from exactly one producer thread and one consumer thread at a time.
+// Capacity must be a power of two; Push fails instead of blocking when full.
+template <typename T, unsigned int Capacity>
+class SpscQueue
+{
+	static_assert(Capacity > 0 && (Capacity & (Capacity - 1)) == 0, "SpscQueue capacity must be a power of two");
+public:
+	// constructor
+	SpscQueue() : head(0), tail(0) { }
+	// appends an item; returns false if the queue is full (producer thread only)
+	bool Push(const T &item)
+	{
+		unsigned int h = this->head.load(std::memory_order_relaxed);
+		if (h - this->tail.load(std::memory_order_acquire) == Capacity)
+			return false;
+		this->items[h & (Capacity - 1)] = item;
+		this->head.store(h + 1, std::memory_order_release);
+		return true;
+	}
+	// removes the oldest item; returns false if the queue is empty (consumer thread only)
+	bool Pop(T &item)
+	{
+		unsigned int t = this->tail.load(std::memory_order_relaxed);
+		if (t == this->head.load(std::memory_order_acquire))
+			return false;
+		item = this->items[t & (Capacity - 1)];
+		this->tail.store(t + 1, std::memory_order_release);
+		return true;
+	}
+	// number of queued items (only a snapshot when the other side is running)
+	unsigned int Size() const
+	{
+		return this->head.load(std::memory_order_acquire) - this->tail.load(std::memory_order_acquire);
+	}
+private:
+	// storage
+	T items[Capacity];
+	// head is written by the producer, tail by the consumer; keep them on separate cache lines
+	char padding0[64];
+	std::atomic<unsigned int> head;
+	char padding1[64];
+	std::atomic<unsigned int> tail;
+};
+
+#endif
@@ -0,0 +1,283 @@
+#include "state_hash.h"
+
+#include <cstring>
+#include <iostream>
+
+#include "game.h"
+
+// fields of the canonical state before the paddles, then per paddle and per ball (see state_hash.h)
+static const char *HEADER_FIELDS[] = { "state", "level", "serving player", "winner", "fixed point", "balls" };
+static const char *PADDLE_FIELDS[] = { "score", "position.x", "position.y" };
+static const char *BALL_FIELDS[] = { "position.x", "position.y", "velocity.x", "velocity.y", "stuck", "hits" };
+const unsigned int HEADER_WORDS = 6, PADDLE_WORDS = 3, BALL_WORDS = 6, PADDLES = 2;
+const unsigned int FIXED_POINT_WORD = 4;
+static const unsigned int STATE_LOG_VERSION = 1;
+
+static uint32_t floatBits(float value)
+{
+	uint32_t bits;
+	memcpy(&bits, &value, sizeof(bits));
+	return bits;
+}
+
+// calls visit with every word of the canonical state, in order
+template <typename F>
+static void visitState(const Game &game, F &&visit)
+{
+	const EntityStore &entities = game.Entities;
+	visit(static_cast<uint32_t>(game.State));
+	visit(game.Level);
+	visit(game.isPlayer1 ? 1u : 2u);
+	visit(game.Player1Win ? 1u : 2u);
+	visit(game.FixedPoint ? 1u : 0u);
+	visit(entities.Kinematics.Size());
+	// the paddles are the entities with a score, player 1 first
+	for (unsigned int i = 0; i < entities.Scores.Size(); ++i)
+	{
+		Entity paddle = entities.Scores.Entities[i];
+		visit(entities.Scores.Dense[i].Points);
+		if (game.FixedPoint)
+		{
+			const FixedBody &body = entities.FixedBodies.Get(paddle);
+			visit(static_cast<uint32_t>(body.Position.x.Raw));
+			visit(static_cast<uint32_t>(body.Position.y.Raw));
+		}
+		else
+		{
+			const glm::vec2 &position = entities.Transforms.Get(paddle).Position;
+			visit(floatBits(position.x));
+			visit(floatBits(position.y));
+		}
+	}
+	for (unsigned int i = 0; i < entities.Kinematics.Size(); ++i)
+	{
+		Entity ball = entities.Kinematics.Entities[i];
+		const Kinematic &kinematic = entities.Kinematics.Dense[i];
+		if (game.FixedPoint)
+		{
+			const FixedBody &body = entities.FixedBodies.Get(ball);
+			visit(static_cast<uint32_t>(body.Position.x.Raw));
+			visit(static_cast<uint32_t>(body.Position.y.Raw));
+			visit(static_cast<uint32_t>(body.Velocity.x.Raw));
+			visit(static_cast<uint32_t>(body.Velocity.y.Raw));
+		}
+		else
+		{
+			const glm::vec2 &position = entities.Transforms.Get(ball).Position;
+			visit(floatBits(position.x));
+			visit(floatBits(position.y));
+			visit(floatBits(kinematic.Velocity.x));
+			visit(floatBits(kinematic.Velocity.y));
+		}
+		visit(kinematic.Stuck ? 1u : 0u);
+		visit(kinematic.Hits);
+	}
+}
+
+void StateWords(const Game &game, std::vector<uint32_t> &words)
+{
+	words.clear();
+	visitState(game, [&words](uint32_t word) { words.push_back(word); });
+}
+
+// one multiply and shift per word: not cryptographic, but every bit of a word reaches the whole hash
+static uint64_t mixWord(uint64_t hash, uint32_t word)
+{
+	hash = (hash ^ word) * 0x9E3779B97F4A7C15ull;
+	return hash ^ (hash >> 29);
+}
+
+uint64_t StateHash(const Game &game)
+{
+	uint64_t hash = 0xCBF29CE484222325ull;
+	visitState(game, [&hash](uint32_t word) { hash = mixWord(hash, word); });
+	return hash;
+}
+
+std::string StateFieldName(unsigned int index)
+{
+	if (index < HEADER_WORDS)
+		return HEADER_FIELDS[index];
+	index -= HEADER_WORDS;
+	if (index < PADDLES * PADDLE_WORDS)
+		return "paddle " + std::to_string(index / PADDLE_WORDS + 1) + " " + PADDLE_FIELDS[index % PADDLE_WORDS];
+	index -= PADDLES * PADDLE_WORDS;
+	return "ball " + std::to_string(index / BALL_WORDS) + " " + BALL_FIELDS[index % BALL_WORDS];
+}
+
+// prints a word as the value it holds: positions and velocities as numbers, with their bits
+static void printWord(const uint32_t *words, unsigned int index)
+{
+	uint32_t word = words[index];
+	bool coordinate = index >= HEADER_WORDS
+		&& (index < HEADER_WORDS + PADDLES * PADDLE_WORDS ? (index - HEADER_WORDS) % PADDLE_WORDS != 0
+			: (index - HEADER_WORDS - PADDLES * PADDLE_WORDS) % BALL_WORDS < 4);
+	if (!coordinate)
+	{
+		std::cout << word;
+		return;
+	}
+	float value;
+	if (words[FIXED_POINT_WORD])
+		value = Fixed::FromRaw(static_cast<int32_t>(word)).ToFloat();
+	else
+		memcpy(&value, &word, sizeof(value));
+	char text[40];
+	snprintf(text, sizeof(text), "%.9g (0x%08x)", value, word);
+	std::cout << text;
+}
+
+// prints the tick's differing fields of two states
+static void printDiff(unsigned int tick, uint64_t hashA, const uint32_t *a, unsigned int countA,
+	uint64_t hashB, const uint32_t *b, unsigned int countB)
+{
+	char hashes[48];
+	snprintf(hashes, sizeof(hashes), "%016llx vs %016llx", static_cast<unsigned long long>(hashA), static_cast<unsigned long long>(hashB));
+	std::cout << "desync at tick " << tick << " (state " << hashes << "):" << std::endl;
+	unsigned int count = countA < countB ? countA : countB;
+	for (unsigned int i = 0; i < count; ++i)
+		if (a[i] != b[i])
+		{
+			std::cout << "  " << StateFieldName(i) << ": ";
+			printWord(a, i);
+			std::cout << " vs ";
+			printWord(b, i);
+			std::cout << std::endl;
+		}
+	if (countA != countB)
+		std::cout << "  fields from " << StateFieldName(count) << " on exist in only one state" << std::endl;
+}
+
+bool StateLog::Open(const char *file)
+{
+	this->Close();
+	this->out = fopen(file, "wb");
+	if (!this->out)
+	{
+		std::cout << "ERROR::STATE_LOG: Failed to open " << file << std::endl;
+		return false;
+	}
+	fwrite("PPST", 1, 4, this->out);
+	fwrite(&STATE_LOG_VERSION, 4, 1, this->out);
+	return true;
+}
+
+void StateLog::Record(const Game &game)
+{
+	StateWords(game, this->words);
+	unsigned int count = static_cast<unsigned int>(this->words.size());
+	uint64_t hash = StateHash(game);
+	fwrite(&count, 4, 1, this->out);
+	fwrite(&hash, 8, 1, this->out);
+	fwrite(this->words.data(), 4, count, this->out);
+}
+
+void StateLog::Close()
+{
+	if (this->out)
+		fclose(this->out);
+	this->out = nullptr;
+}
+
+bool StateLog::read(const char *file, std::vector<char> &data, std::vector<size_t> &offsets)
+{
+	FILE *in = fopen(file, "rb");
+	if (!in)
+	{
+		std::cout << "ERROR::STATE_LOG: Failed to open " << file << std::endl;
+		return false;
+	}
+	fseek(in, 0, SEEK_END);
+	long size = ftell(in);
+	fseek(in, 0, SEEK_SET);
+	data.resize(size > 0 ? static_cast<size_t>(size) : 0);
+	bool ok = !data.empty() && fread(data.data(), 1, data.size(), in) == data.size();
+	fclose(in);
+	unsigned int version = 0;
+	ok = ok && data.size() >= 8 && memcmp(data.data(), "PPST", 4) == 0;
+	if (ok)
+		memcpy(&version, data.data() + 4, 4);
+	ok = ok && version == STATE_LOG_VERSION;
+	// index the ticks: word count, hash, words
+	offsets.clear();
+	for (size_t offset = 8; ok && offset < data.size(); )
+	{
+		unsigned int count;
+		ok = offset + 12 <= data.size();
+		if (!ok)
+			break;
+		memcpy(&count, data.data() + offset, 4);
+		ok = offset + 12 + static_cast<size_t>(count) * 4 <= data.size();
+		offsets.push_back(offset);
+		offset += 12 + static_cast<size_t>(count) * 4;
+	}
+	if (!ok)
+		std::cout << "ERROR::STATE_LOG: Not a valid state log: " << file << std::endl;
+	return ok;
+}
+
+bool StateLog::Load(const char *file)
+{
+	this->reference = file;
+	return read(file, this->data, this->offsets);
+}
+
+// the word count, hash and words of a tick of a loaded log
+static void tickState(const std::vector<char> &data, size_t offset, unsigned int &count, uint64_t &hash, std::vector<uint32_t> &words)
+{
+	memcpy(&count, data.data() + offset, 4);
+	memcpy(&hash, data.data() + offset + 4, 8);
+	words.resize(count);
+	if (count)
+		memcpy(words.data(), data.data() + offset + 12, static_cast<size_t>(count) * 4);
+}
+
+bool StateLog::Check(unsigned int tick, const Game &game)
+{
+	if (tick >= this->offsets.size())
+	{
+		std::cout << this->reference << " ends before tick " << tick << std::endl;
+		return false;
+	}
+	uint64_t hash = StateHash(game), expected;
+	memcpy(&expected, this->data.data() + this->offsets[tick] + 4, 8);
+	if (hash == expected)
+		return true;
+	// only a mismatch pays for the field-level comparison
+	unsigned int count;
+	std::vector<uint32_t> reference;
+	tickState(this->data, this->offsets[tick], count, expected, reference);
+	StateWords(game, this->words);
+	printDiff(tick, hash, this->words.data(), static_cast<unsigned int>(this->words.size()), expected, reference.data(), count);
+	return false;
+}
+
+bool StateLog::Compare(const char *fileA, const char *fileB)
+{
+	std::vector<char> dataA, dataB;
+	std::vector<size_t> offsetsA, offsetsB;
+	if (!read(fileA, dataA, offsetsA) || !read(fileB, dataB, offsetsB))
+		return false;
+	size_t ticks = offsetsA.size() < offsetsB.size() ? offsetsA.size() : offsetsB.size();
+	std::vector<uint32_t> wordsA, wordsB;
+	for (size_t tick = 0; tick < ticks; ++tick)
+	{
+		unsigned int countA, countB;
+		uint64_t hashA, hashB;
+		tickState(dataA, offsetsA[tick], countA, hashA, wordsA);
+		tickState(dataB, offsetsB[tick], countB, hashB, wordsB);
+		if (hashA != hashB)
+		{
+			printDiff(static_cast<unsigned int>(tick), hashA, wordsA.data(), countA, hashB, wordsB.data(), countB);
+			return false;
+		}
+	}
+	if (offsetsA.size() != offsetsB.size())
+	{
+		std::cout << "the logs agree on all " << ticks << " ticks they share, but one has " << offsetsA.size()
+			<< " ticks and the other " << offsetsB.size() << std::endl;
+		return false;
+	}
+	std::cout << "the logs agree on all " << ticks << " ticks" << std::endl;
+	return true;
+}
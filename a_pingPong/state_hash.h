@@ -0,0 +1,58 @@
+#ifndef STATE_HASH_H
+#define STATE_HASH_H
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+class Game;
+
+// The canonical simulation state is a list of 32-bit words, in this order:
+//   state, level, serving player, fixed point, score of player 1 and 2, balls,
+//   position x/y of paddle 1 and paddle 2,
+//   then for every ball: position x/y, velocity x/y, stuck, hits.
+// Positions and velocities are the raw Q16.16 values in fixed-point mode and
+// the float bits otherwise. The particles are effects and not part of it, and
+// the simulation draws no random numbers, so there is no RNG state to include.
+
+// writes the canonical state of game into words (resized to fit)
+void          StateWords(const Game &game, std::vector<uint32_t> &words);
+// 64-bit hash of the canonical state; cheap enough for every tick and allocation free
+uint64_t      StateHash(const Game &game);
+// name of the word at index in the canonical state ("ball 2 velocity.x")
+std::string   StateFieldName(unsigned int index);
+
+
+// StateLog writes the canonical state of every tick to a file ("PPST"
+// header, then per tick the word count, the hash and the words), and
+// checks a running game or another log against one. The first tick whose
+// hash differs is reported with every field that differs, which is where
+// bisecting a desync starts.
+class StateLog
+{
+public:
+	StateLog() : out(nullptr), reference(nullptr) { }
+	~StateLog() { this->Close(); }
+	// starts writing a log; returns false (and prints an error) on failure
+	bool Open(const char *file);
+	// appends the game's current state as the next tick
+	void Record(const Game &game);
+	void Close();
+	// loads a log to check against; returns false (and prints an error) on failure
+	bool Load(const char *file);
+	// compares the game's state with the tick of the loaded log; prints the divergence and returns false on a mismatch
+	bool Check(unsigned int tick, const Game &game);
+	// compares two logs; prints the first divergent tick and returns false if they differ
+	static bool Compare(const char *fileA, const char *fileB);
+private:
+	FILE                  *out;
+	const char            *reference;
+	std::vector<char>      data;    // the loaded log
+	std::vector<size_t>    offsets; // start of every tick in data
+	std::vector<uint32_t>  words;
+	// reads the log file into data and offsets
+	static bool read(const char *file, std::vector<char> &data, std::vector<size_t> &offsets);
+};
+
+#endif
@@ -0,0 +1,105 @@
+#include "stream_buffer.h"
+
+#include <glad/glad.h>
+
+#include <iostream>
+
+StreamBuffer::StreamBuffer()
+	: ID(0), size(0), head(0), region(0), mapped(nullptr)
+{
+	for (unsigned int i = 0; i < REGIONS; ++i)
+		this->fences[i] = nullptr;
+}
+
+StreamBuffer::~StreamBuffer()
+{
+	for (unsigned int i = 0; i < REGIONS; ++i)
+		if (this->fences[i])
+			glDeleteSync(static_cast<GLsync>(this->fences[i]));
+	if (this->mapped)
+	{
+		glBindBuffer(GL_ARRAY_BUFFER, this->ID);
+		glUnmapBuffer(GL_ARRAY_BUFFER);
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+	}
+	if (this->ID)
+		glDeleteBuffers(1, &this->ID);
+}
+
+void StreamBuffer::Init(size_t size)
+{
+	this->size = size;
+	glGenBuffers(1, &this->ID);
+	glBindBuffer(GL_ARRAY_BUFFER, this->ID);
+#ifdef GL_ARB_buffer_storage
+	if (GLAD_GL_ARB_buffer_storage)
+	{
+		GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+		glBufferStorage(GL_ARRAY_BUFFER, size, NULL, flags);
+		this->mapped = static_cast<unsigned char*>(glMapBufferRange(GL_ARRAY_BUFFER, 0, size, flags));
+		if (!this->mapped)
+			std::cout << "ERROR::STREAM_BUFFER: Persistent mapping failed" << std::endl;
+	}
+	else
+#endif
+		glBufferData(GL_ARRAY_BUFFER, size, NULL, GL_STREAM_DRAW);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void *StreamBuffer::Map(size_t bytes, size_t alignment, size_t &offset)
+{
+	size_t regionSize = this->size / REGIONS;
+	if (bytes > regionSize)
+	{
+		std::cout << "ERROR::STREAM_BUFFER: " << bytes << " bytes do not fit a " << regionSize << " byte region" << std::endl;
+		return nullptr;
+	}
+	size_t start = (this->head + alignment - 1) / alignment * alignment;
+	if (this->mapped)
+	{
+		// a write never straddles two regions: its first region would be fenced before the
+		// draw reading it is issued. This way a region is fenced only once writing moves
+		// past it, after every draw from it has been issued
+		unsigned int first = static_cast<unsigned int>(start / regionSize);
+		while (first < REGIONS && start + bytes > (first + 1) * regionSize)
+		{
+			++first;
+			start = (first * regionSize + alignment - 1) / alignment * alignment;
+		}
+		if (first >= REGIONS)
+			start = first = 0;
+		while (this->region != first)
+			this->nextRegion();
+	}
+	else if (start + bytes > this->size)
+	{
+		// orphan: the driver hands out fresh storage while draws still read the old one
+		start = 0;
+		glBufferData(GL_ARRAY_BUFFER, this->size, NULL, GL_STREAM_DRAW);
+	}
+	this->head = start + bytes;
+	offset = start;
+	if (this->mapped)
+		return this->mapped + start;
+	return glMapBufferRange(GL_ARRAY_BUFFER, start, bytes,
+		GL_MAP_WRITE_BIT | GL_MAP_UNSYNCHRONIZED_BIT | GL_MAP_INVALIDATE_RANGE_BIT);
+}
+
+void StreamBuffer::Unmap()
+{
+	if (!this->mapped)
+		glUnmapBuffer(GL_ARRAY_BUFFER);
+}
+
+void StreamBuffer::nextRegion()
+{
+	this->fences[this->region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	this->region = (this->region + 1) % REGIONS;
+	GLsync fence = static_cast<GLsync>(this->fences[this->region]);
+	if (!fence)
+		return;
+	// only blocks when the GPU is more than REGIONS - 1 regions behind
+	glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, GL_TIMEOUT_IGNORED);
+	glDeleteSync(fence);
+	this->fences[this->region] = nullptr;
+}
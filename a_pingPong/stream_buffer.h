@@ -0,0 +1,46 @@
+#ifndef STREAM_BUFFER_H
+#define STREAM_BUFFER_H
+
+#include <cstddef>
+
+
+// StreamBuffer is a ring buffer for geometry that is rewritten every frame.
+// On GL 4.4 (or ARB_buffer_storage) the buffer is mapped once, persistently
+// and coherently; the ring is split into REGIONS regions, no write straddles
+// two of them, and a fence placed when writing leaves a region is waited on
+// before the region is reused, so the CPU never overwrites data the GPU has
+// yet to read. On plain GL 3.3 each
+// write maps its range unsynchronized and the buffer is orphaned whenever the
+// ring wraps around, which gives the driver the same guarantee.
+class StreamBuffer
+{
+public:
+	static const unsigned int REGIONS = 3;
+	// buffer object; bind it as GL_ARRAY_BUFFER to point vertex attributes at it
+	unsigned int ID;
+	// constructor/destructor
+	StreamBuffer();
+	~StreamBuffer();
+	// creates the buffer; a single Map may not exceed size / REGIONS bytes
+	void          Init(size_t size);
+	// reserves space for bytes at an offset that is a multiple of alignment (e.g. the
+	// vertex stride, so offset / stride can be passed as the first vertex) and returns
+	// where to write them; the buffer must be bound to GL_ARRAY_BUFFER
+	void         *Map(size_t bytes, size_t alignment, size_t &offset);
+	// finishes the writes of the last Map; call before drawing from it
+	void          Unmap();
+	// true when the persistent mapping path is in use
+	bool          Persistent() const { return this->mapped != nullptr; }
+	// owns GL objects and a mapping, so it cannot be copied
+	StreamBuffer(const StreamBuffer&) = delete;
+	StreamBuffer &operator=(const StreamBuffer&) = delete;
+private:
+	size_t         size, head;
+	unsigned int   region;
+	unsigned char *mapped;
+	void          *fences[REGIONS];
+	// fences the current region and waits until the next one is free
+	void nextRegion();
+};
+
+#endif
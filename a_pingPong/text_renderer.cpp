@@ -1,3 +1,4 @@
+#include <cstring>
 #include <iostream>
 
 #include <glm/gtc/matrix_transform.hpp>
@@ -5,6 +6,7 @@
 #include FT_FREETYPE_H
 
 #include "text_renderer.h"
+#include "frame_arena.h"
 #include "resource_manager.h"
 
 
@@ -16,10 +18,9 @@ TextRenderer::TextRenderer(unsigned int width, unsigned int height)
 	this->TextShader.SetInteger("text", 0);
 	// configure VAO/VBO for texture quads
 	glGenVertexArrays(1, &this->VAO);
-	glGenBuffers(1, &this->VBO);
+	this->vertices.Init(StreamBuffer::REGIONS * 4 * sizeof(float) * 6 * 4 * MAX_GLYPHS);
 	glBindVertexArray(this->VAO);
-	glBindBuffer(GL_ARRAY_BUFFER, this->VBO);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(float) * 6 * 4, NULL, GL_DYNAMIC_DRAW);
+	glBindBuffer(GL_ARRAY_BUFFER, this->vertices.ID);
 	glEnableVertexAttribArray(0);
 	glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, 4 * sizeof(float), 0);
 	glBindBuffer(GL_ARRAY_BUFFER, 0);
@@ -87,7 +88,12 @@ void TextRenderer::Load(std::string font, unsigned int fontSize)
 	FT_Done_FreeType(ft);
 }
 
-void TextRenderer::RenderText(std::string text, float x, float y, float scale, glm::vec3 color)
+void TextRenderer::RenderText(const std::string &text, float x, float y, float scale, glm::vec3 color)
+{
+	this->RenderText(text.c_str(), x, y, scale, color);
+}
+
+void TextRenderer::RenderText(const char *text, float x, float y, float scale, glm::vec3 color)
 {
 	// activate corresponding render state	
 	this->TextShader.Use();
@@ -95,38 +101,57 @@ void TextRenderer::RenderText(std::string text, float x, float y, float scale, g
 	glActiveTexture(GL_TEXTURE0);
 	glBindVertexArray(this->VAO);
 
-	// iterate through all characters
-	std::string::const_iterator c;
-	for (c = text.begin(); c != text.end(); c++)
+	// lay out the quads of the whole string in frame memory first; characters missing from the font are skipped
+	size_t length = strlen(text);
+	float (*quads)[6][4] = FrameArena::Allocate<float[6][4]>(length);
+	unsigned int *textures = FrameArena::Allocate<unsigned int>(length);
+	unsigned int glyphs = 0;
+	int baseline = this->Characters['H'].Bearing.y;
+	for (const char *c = text; *c; c++)
 	{
-		Character ch = Characters[*c];
+		std::map<char, Character>::const_iterator glyph = this->Characters.find(*c);
+		if (glyph == this->Characters.end())
+			continue;
+		const Character &ch = glyph->second;
 
 		float xpos = x + ch.Bearing.x * scale;
-		float ypos = y + (this->Characters['H'].Bearing.y - ch.Bearing.y) * scale;
+		float ypos = y + (baseline - ch.Bearing.y) * scale;
 
 		float w = ch.Size.x * scale;
 		float h = ch.Size.y * scale;
-		// update VBO for each character
-		float vertices[6][4] = {
+		float quad[6][4] = {
 			{ xpos,     ypos + h,   0.0f, 1.0f },
-		{ xpos + w, ypos,       1.0f, 0.0f },
-		{ xpos,     ypos,       0.0f, 0.0f },
+			{ xpos + w, ypos,       1.0f, 0.0f },
+			{ xpos,     ypos,       0.0f, 0.0f },
 
-		{ xpos,     ypos + h,   0.0f, 1.0f },
-		{ xpos + w, ypos + h,   1.0f, 1.0f },
-		{ xpos + w, ypos,       1.0f, 0.0f }
+			{ xpos,     ypos + h,   0.0f, 1.0f },
+			{ xpos + w, ypos + h,   1.0f, 1.0f },
+			{ xpos + w, ypos,       1.0f, 0.0f }
 		};
-		// render glyph texture over quad
-		glBindTexture(GL_TEXTURE_2D, ch.TextureID);
-		// update content of VBO memory
-		glBindBuffer(GL_ARRAY_BUFFER, this->VBO);
-		glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(vertices), vertices); // be sure to use glBufferSubData and not glBufferData
-		glBindBuffer(GL_ARRAY_BUFFER, 0);
-		// render quad
-		glDrawArrays(GL_TRIANGLES, 0, 6);
+		memcpy(quads[glyphs], quad, sizeof(quad));
+		textures[glyphs++] = ch.TextureID;
 		// now advance cursors for next glyph
 		x += (ch.Advance >> 6) * scale; // bitshift by 6 to get value in pixels (1/64th times 2^6 = 64)
 	}
+	// then copy them into the stream buffer, up to MAX_GLYPHS characters at a time, and draw each glyph texture over its quad
+	glBindBuffer(GL_ARRAY_BUFFER, this->vertices.ID);
+	for (unsigned int first = 0; first < glyphs; first += MAX_GLYPHS)
+	{
+		unsigned int count = glyphs - first < MAX_GLYPHS ? glyphs - first : MAX_GLYPHS;
+		size_t offset;
+		void *memory = this->vertices.Map(count * sizeof(quads[0]), sizeof(quads[0][0]), offset);
+		if (!memory)
+			break;
+		memcpy(memory, quads[first], count * sizeof(quads[0]));
+		this->vertices.Unmap();
+		GLint vertex = static_cast<GLint>(offset / sizeof(quads[0][0]));
+		for (unsigned int i = 0; i < count; ++i)
+		{
+			glBindTexture(GL_TEXTURE_2D, textures[first + i]);
+			glDrawArrays(GL_TRIANGLES, vertex + i * 6, 6);
+		}
+	}
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
 	glBindVertexArray(0);
 	glBindTexture(GL_TEXTURE_2D, 0);
 }
\ No newline at end of file
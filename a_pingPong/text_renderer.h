@@ -2,12 +2,14 @@
 #define TEXT_RENDERER_H
 
 #include <map>
+#include <string>
 
 #include <glad/glad.h>
 #include <glm/glm.hpp>
 
 #include "texture.h"
 #include "shader.h"
+#include "stream_buffer.h"
 
 
 /// Holds all state information relevant to a character as loaded using FreeType
@@ -34,10 +36,15 @@ public:
 	// pre-compiles a list of characters from the given font
 	void Load(std::string font, unsigned int fontSize);
 	// renders a string of text using the precompiled list of characters
-	void RenderText(std::string text, float x, float y, float scale, glm::vec3 color = glm::vec3(1.0f));
+	void RenderText(const std::string &text, float x, float y, float scale, glm::vec3 color = glm::vec3(1.0f));
+	// same for a null-terminated string; string literals take this overload and build no std::string
+	void RenderText(const char *text, float x, float y, float scale, glm::vec3 color = glm::vec3(1.0f));
 private:
-	// render state
-	unsigned int VAO, VBO;
+	// characters uploaded per buffer update; longer strings are drawn in parts
+	static const unsigned int MAX_GLYPHS = 128;
+	// render state; glyph quads are streamed through a ring buffer
+	unsigned int VAO;
+	StreamBuffer vertices;
 };
 
 #endif 
\ No newline at end of file
@@ -20,7 +20,7 @@ public:
 	unsigned int Wrap_T; // wrapping mode on T axis
 	unsigned int Filter_Min; // filtering mode if texture pixels < screen pixels
 	unsigned int Filter_Max; // filtering mode if texture pixels > screen pixels
-							 // constructor (sets default texture modes)
+							 // constructor (sets default texture modes; the GL texture is created by Generate)
 	Texture2D();
 	// generates texture from image data
 	void Generate(unsigned int width, unsigned int height, unsigned char* data);
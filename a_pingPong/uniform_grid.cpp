@@ -0,0 +1,60 @@
+#include "uniform_grid.h"
+
+#include <algorithm>
+#include <cmath>
+
+void UniformGrid::Init(glm::vec2 size, float cellSize)
+{
+	this->cellSize = cellSize;
+	this->columns = std::max(1, static_cast<int>(std::ceil(size.x / cellSize)));
+	this->rows = std::max(1, static_cast<int>(std::ceil(size.y / cellSize)));
+	this->cellStart.assign(this->columns * this->rows + 1, 0);
+	this->Clear();
+}
+
+void UniformGrid::Clear()
+{
+	this->items.clear();
+}
+
+void UniformGrid::Insert(unsigned int id, glm::vec2 min, glm::vec2 max)
+{
+	Item item = { id, min, max,
+		this->cell(min.x, this->columns), this->cell(min.y, this->rows),
+		this->cell(max.x, this->columns), this->cell(max.y, this->rows) };
+	this->items.push_back(item);
+}
+
+void UniformGrid::Build()
+{
+	// count the items of every cell, turn the counts into start offsets, then place the items
+	std::fill(this->cellStart.begin(), this->cellStart.end(), 0);
+	unsigned int total = 0;
+	for (const Item &item : this->items)
+		for (int y = item.Y0; y <= item.Y1; ++y)
+			for (int x = item.X0; x <= item.X1; ++x)
+			{
+				++this->cellStart[y * this->columns + x + 1];
+				++total;
+			}
+	for (size_t c = 1; c < this->cellStart.size(); ++c)
+		this->cellStart[c] += this->cellStart[c - 1];
+	this->cellItems.resize(total);
+	for (unsigned int i = 0; i < this->items.size(); ++i)
+	{
+		const Item &item = this->items[i];
+		for (int y = item.Y0; y <= item.Y1; ++y)
+			for (int x = item.X0; x <= item.X1; ++x)
+				this->cellItems[this->cellStart[y * this->columns + x]++] = i;
+	}
+	// placing advanced every start to the next cell's; shift them back
+	for (size_t c = this->cellStart.size() - 1; c > 0; --c)
+		this->cellStart[c] = this->cellStart[c - 1];
+	this->cellStart[0] = 0;
+}
+
+int UniformGrid::cell(float coordinate, int count) const
+{
+	int index = static_cast<int>(std::floor(coordinate / this->cellSize));
+	return std::min(std::max(index, 0), count - 1);
+}
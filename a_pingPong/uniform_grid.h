@@ -0,0 +1,95 @@
+#ifndef UNIFORM_GRID_H
+#define UNIFORM_GRID_H
+
+#include <algorithm>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+
+// UniformGrid is the collision broadphase: rectangles are bucketed into
+// square cells (counting sort, so rebuilding every frame only reuses
+// memory) and only rectangles sharing a cell are tested against each
+// other, which keeps the cost near-linear in the number of objects.
+// Rectangles larger than a cell go into every cell they cover; each
+// overlapping pair is still reported once. Positions outside the grid are
+// clamped into its border cells.
+class UniformGrid
+{
+public:
+	// constructor
+	UniformGrid() : cellSize(1.0f), columns(1), rows(1) { }
+	// covers [0, size) with cells of cellSize pixels
+	void Init(glm::vec2 size, float cellSize);
+	// starts a new frame; then Insert everything and Build
+	void Clear();
+	void Insert(unsigned int id, glm::vec2 min, glm::vec2 max);
+	void Build();
+	// calls pair(idA, idB) once for every two inserted rectangles that overlap
+	template <typename F>
+	void ForEachPair(F pair) const;
+	// calls overlap(id) once for every inserted rectangle that overlaps [min, max]
+	template <typename F>
+	void ForEachOverlap(glm::vec2 min, glm::vec2 max, F overlap) const;
+private:
+	struct Item {
+		unsigned int Id;
+		glm::vec2    Min, Max;
+		int          X0, Y0, X1, Y1; // covered cells, inclusive
+	};
+	float cellSize;
+	int   columns, rows;
+	std::vector<Item>         items;
+	// items of cell c are cellItems[cellStart[c], cellStart[c + 1])
+	std::vector<unsigned int> cellStart;
+	std::vector<unsigned int> cellItems;
+	int cell(float coordinate, int count) const;
+};
+
+template <typename F>
+void UniformGrid::ForEachPair(F pair) const
+{
+	for (int y = 0; y < this->rows; ++y)
+		for (int x = 0; x < this->columns; ++x)
+		{
+			unsigned int c = y * this->columns + x;
+			for (unsigned int i = this->cellStart[c]; i < this->cellStart[c + 1]; ++i)
+			{
+				const Item &a = this->items[this->cellItems[i]];
+				for (unsigned int j = i + 1; j < this->cellStart[c + 1]; ++j)
+				{
+					const Item &b = this->items[this->cellItems[j]];
+					if (a.Max.x < b.Min.x || b.Max.x < a.Min.x || a.Max.y < b.Min.y || b.Max.y < a.Min.y)
+						continue;
+					// pairs sharing several cells are only reported from the first of them
+					if (std::max(a.X0, b.X0) != x || std::max(a.Y0, b.Y0) != y)
+						continue;
+					pair(a.Id, b.Id);
+				}
+			}
+		}
+}
+
+template <typename F>
+void UniformGrid::ForEachOverlap(glm::vec2 min, glm::vec2 max, F overlap) const
+{
+	int x0 = this->cell(min.x, this->columns), y0 = this->cell(min.y, this->rows);
+	int x1 = this->cell(max.x, this->columns), y1 = this->cell(max.y, this->rows);
+	for (int y = y0; y <= y1; ++y)
+		for (int x = x0; x <= x1; ++x)
+		{
+			unsigned int c = y * this->columns + x;
+			for (unsigned int i = this->cellStart[c]; i < this->cellStart[c + 1]; ++i)
+			{
+				const Item &item = this->items[this->cellItems[i]];
+				if (item.Max.x < min.x || max.x < item.Min.x || item.Max.y < min.y || max.y < item.Min.y)
+					continue;
+				// rectangles sharing several cells with the query are only reported from the first of them
+				if (std::max(item.X0, x0) != x || std::max(item.Y0, y0) != y)
+					continue;
+				overlap(item.Id);
+			}
+		}
+}
+
+#endif
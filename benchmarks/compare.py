@@ -0,0 +1,80 @@
+#!/usr/bin/env python3
+"""Compares two Google Benchmark JSON results and flags regressions.
+
+usage: compare.py baseline.json current.json [--threshold 0.10]
+
+Prints the change in real time per iteration for every benchmark present
+in both files and exits with status 1 if any benchmark got slower by more
+than the threshold (a fraction; 0.10 = 10%). When the runs were made with
+--benchmark_repetitions, the median aggregate is compared.
+"""
+import argparse
+import json
+import sys
+
+
+def load(path):
+    with open(path) as f:
+        data = json.load(f)
+    results = {}
+    medians = {}
+    for bench in data.get("benchmarks", []):
+        if bench.get("error_occurred"):
+            continue
+        if bench.get("run_type") == "aggregate":
+            if bench.get("aggregate_name") == "median":
+                medians[bench["run_name"]] = bench
+            continue
+        # without repetitions there is one iteration entry per benchmark
+        results.setdefault(bench.get("run_name", bench["name"]), bench)
+    results.update(medians)
+    return {name: to_ns(bench) for name, bench in results.items()}
+
+
+def to_ns(bench):
+    scale = {"ns": 1.0, "us": 1e3, "ms": 1e6, "s": 1e9}[bench.get("time_unit", "ns")]
+    return bench["real_time"] * scale
+
+
+def format_time(ns):
+    for unit, scale in (("s", 1e9), ("ms", 1e6), ("us", 1e3)):
+        if ns >= scale:
+            return "%.2f %s" % (ns / scale, unit)
+    return "%.1f ns" % ns
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("baseline")
+    parser.add_argument("current")
+    parser.add_argument("--threshold", type=float, default=0.10,
+                        help="relative slowdown reported as a regression (default 0.10)")
+    args = parser.parse_args()
+
+    baseline = load(args.baseline)
+    current = load(args.current)
+    regressions = 0
+    width = max([len(name) for name in current] + [9])
+    print("%-*s %12s %12s %8s" % (width, "benchmark", "baseline", "current", "change"))
+    for name in sorted(current):
+        if name not in baseline:
+            print("%-*s %12s %12s %8s" % (width, name, "-", format_time(current[name]), "new"))
+            continue
+        change = current[name] / baseline[name] - 1.0
+        flag = ""
+        if change > args.threshold:
+            flag = "  REGRESSION"
+            regressions += 1
+        print("%-*s %12s %12s %+7.1f%%%s" % (width, name, format_time(baseline[name]),
+                                            format_time(current[name]), change * 100.0, flag))
+    for name in sorted(set(baseline) - set(current)):
+        print("%-*s %12s %12s %8s" % (width, name, format_time(baseline[name]), "-", "missing"))
+
+    if regressions:
+        print("%d benchmark(s) slower than the baseline by more than %.0f%%" % (regressions, args.threshold * 100.0))
+        return 1
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,454 @@
+#include <glad/glad.h>
+#include <benchmark/benchmark.h>
+
+#include "batch_sim.h"
+#include "frame_arena.h"
+#include "game.h"
+#include "game_systems.h"
+#include "gpu_particle_generator.h"
+#include "job_system.h"
+#include "offscreen_context.h"
+#include "particle_generator.h"
+#include "resource_manager.h"
+#include "sprite_renderer.h"
+#include "state_hash.h"
+#include "text_renderer.h"
+#include "uniform_grid.h"
+
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+#ifdef _WIN32
+#include <direct.h>
+#define chdir _chdir
+#else
+#include <unistd.h>
+#endif
+
+// Microbenchmarks for the simulation and rendering hot paths. Everything
+// runs against one offscreen context and one initialized game; rendering
+// benchmarks end each iteration with glFinish so they time the GPU work
+// (on Mesa's llvmpipe: the rasterizer) and not just command submission.
+// --data is the directory with the shaders, textures and fonts:
+//
+//   pingpong_benchmarks --data <data dir> --benchmark_out=current.json --benchmark_out_format=json
+//   python3 benchmarks/compare.py benchmarks/baseline.json current.json
+
+const unsigned int SCREEN_WIDTH = 900;
+const unsigned int SCREEN_HEIGHT = 600;
+
+static OffscreenContext *Context;
+static Game             *PingPong;
+
+// skips rendering benchmarks when no context could be created
+static bool needsContext(benchmark::State &state)
+{
+	if (Context)
+		return true;
+	state.SkipWithError("no OpenGL context");
+	return false;
+}
+
+// simulation
+// ----------
+static void BM_CheckCollision(benchmark::State &state)
+{
+	// Arg: 1 = ball overlapping the paddle, 0 = ball far away
+	Transform paddle = { glm::vec2(5.0f, 250.0f), PLAYER_SIZE, 0.0f };
+	glm::vec2 ballPosition = state.range(0) ? glm::vec2(20.0f, 290.0f) : glm::vec2(450.0f, 300.0f);
+	Transform ball = { ballPosition, glm::vec2(BALL_RADIUS * 2.0f), 0.0f };
+	for (auto _ : state)
+	{
+		benchmark::DoNotOptimize(ball.Position);
+		Collision result = CheckCollision(ball, BALL_RADIUS, paddle);
+		benchmark::DoNotOptimize(result);
+	}
+}
+BENCHMARK(BM_CheckCollision)->Arg(0)->Arg(1);
+
+static void BM_VectorDirection(benchmark::State &state)
+{
+	glm::vec2 target(0.3f, -0.8f);
+	for (auto _ : state)
+	{
+		benchmark::DoNotOptimize(target);
+		Direction direction = VectorDirection(target);
+		benchmark::DoNotOptimize(direction);
+	}
+}
+BENCHMARK(BM_VectorDirection);
+
+static void BM_BallMove(benchmark::State &state)
+{
+	// Arg: balls moved by one MoveSystem pass
+	unsigned int count = static_cast<unsigned int>(state.range(0));
+	EntityStore entities;
+	for (unsigned int i = 0; i < count; ++i)
+	{
+		Entity ball = entities.Create();
+		entities.Transforms.Add(ball, { glm::vec2(450.0f, 300.0f), glm::vec2(BALL_RADIUS * 2.0f), 0.0f });
+		entities.Kinematics.Add(ball, { glm::vec2(300.0f, -400.0f), false, 0 });
+	}
+	Transform &first = entities.Transforms.Get(0);
+	for (auto _ : state)
+	{
+		MoveSystem(entities, 1.0f / 60.0f, SCREEN_HEIGHT, true);
+		benchmark::DoNotOptimize(first.Position);
+		// keep the balls on screen horizontally; MoveSystem only bounces off the top and bottom
+		if (first.Position.x < 0.0f || first.Position.x > SCREEN_WIDTH)
+			for (Transform &transform : entities.Transforms.Dense)
+				transform.Position.x = 450.0f;
+	}
+	state.SetItemsProcessed(state.iterations() * count);
+}
+BENCHMARK(BM_BallMove)->Arg(1)->Arg(1000);
+
+static void BM_ParticleUpdate(benchmark::State &state)
+{
+	// Args: particles spawned per update, pool size; 50 per update keeps a
+	// 500 pool saturated, and a large pool should cost no more than a small
+	// one with the same number of live particles; 3500 per update keeps
+	// ~200k alive, the spectator-screen load
+	if (!needsContext(state))
+		return;
+	unsigned int spawn = static_cast<unsigned int>(state.range(0));
+	unsigned int amount = static_cast<unsigned int>(state.range(1));
+	ParticleGenerator particles(ResourceManager::GetShader("particle"), ResourceManager::GetTexture("particle"), amount);
+	glm::vec2 ball(450.0f, 300.0f);
+	unsigned long long live = 0;
+	for (auto _ : state)
+	{
+		particles.Update(1.0f / 60.0f, ball, INITIAL_BALL_VELOCITY, spawn, glm::vec2(BALL_RADIUS / 2.0f));
+		live += particles.LiveCount();
+	}
+	state.SetItemsProcessed(live);
+}
+BENCHMARK(BM_ParticleUpdate)->Args({2, 500})->Args({50, 500})->Args({2, 100000})->Args({3500, 200000});
+
+static void BM_ParticleUpdateThreads(benchmark::State &state)
+{
+	// Arg: threads (including this one) updating a pool of ~1M live particles
+	if (!needsContext(state))
+		return;
+	unsigned int threads = static_cast<unsigned int>(state.range(0));
+	if (threads > 1)
+		JobSystem::Start(threads - 1);
+	ParticleGenerator particles(ResourceManager::GetShader("particle"), ResourceManager::GetTexture("particle"), 1000000);
+	glm::vec2 ball(450.0f, 300.0f);
+	// one second of spawning fills the pool
+	for (int i = 0; i < 60; ++i)
+		particles.Update(1.0f / 60.0f, ball, INITIAL_BALL_VELOCITY, 16667);
+	unsigned long long live = 0;
+	for (auto _ : state)
+	{
+		particles.Update(1.0f / 60.0f, ball, INITIAL_BALL_VELOCITY, 16667);
+		live += particles.LiveCount();
+	}
+	state.SetItemsProcessed(live);
+	JobSystem::Stop();
+}
+BENCHMARK(BM_ParticleUpdateThreads)->Arg(1)->Arg(2)->Arg(4)->Arg(8)->UseRealTime();
+
+static void BM_GpuParticleUpdate(benchmark::State &state)
+{
+	// Arg: pool size; transform feedback step plus glFinish, so it times the GPU work
+	if (!needsContext(state))
+		return;
+	unsigned int amount = static_cast<unsigned int>(state.range(0));
+	Shader update = ResourceManager::LoadTransformFeedbackShader("shaders/particle/particle_update.vs",
+		GpuParticleGenerator::VARYINGS, 4, "particle_update");
+	GpuParticleGenerator particles(update, ResourceManager::GetShader("particle"), ResourceManager::GetTexture("particle"), amount);
+	glm::vec2 ball(450.0f, 300.0f);
+	for (auto _ : state)
+	{
+		particles.Update(1.0f / 60.0f, ball, INITIAL_BALL_VELOCITY, amount / 250, glm::vec2(BALL_RADIUS / 2.0f));
+		glFinish();
+	}
+	state.SetItemsProcessed(state.iterations() * amount);
+}
+BENCHMARK(BM_GpuParticleUpdate)->Arg(500)->Arg(100000);
+
+static void BM_GameUpdate(benchmark::State &state)
+{
+	// one full autopilot tick: input, ball, collisions, particles and scoring
+	if (!needsContext(state))
+		return;
+	for (auto _ : state)
+	{
+		PingPong->Autopilot();
+		PingPong->ProcessInput(1.0f / 60.0f);
+		PingPong->Update(1.0f / 60.0f);
+	}
+}
+BENCHMARK(BM_GameUpdate);
+
+static void BM_StateHash(benchmark::State &state)
+{
+	// the hash of the game in play, which desync detection pays for every tick
+	if (!needsContext(state))
+		return;
+	for (auto _ : state)
+		benchmark::DoNotOptimize(StateHash(*PingPong));
+}
+BENCHMARK(BM_StateHash);
+
+static void BM_Broadphase(benchmark::State &state)
+{
+	// Arg: balls scattered over the field plus two paddles; one frame of grid
+	// rebuild and pair reporting. The cost follows the balls plus the pairs that
+	// share a cell, so it only grows faster than linearly as the field gets crowded
+	unsigned int count = static_cast<unsigned int>(state.range(0));
+	std::vector<glm::vec2> positions;
+	unsigned int seed = 1;
+	for (unsigned int i = 0; i < count; ++i)
+	{
+		seed = seed * 1664525u + 1013904223u;
+		float x = (seed >> 8) % (SCREEN_WIDTH - 26);
+		seed = seed * 1664525u + 1013904223u;
+		float y = (seed >> 8) % (SCREEN_HEIGHT - 26);
+		positions.push_back(glm::vec2(x, y));
+	}
+	UniformGrid grid;
+	grid.Init(glm::vec2(SCREEN_WIDTH, SCREEN_HEIGHT), 4.0f * BALL_RADIUS);
+	unsigned long long pairs = 0;
+	for (auto _ : state)
+	{
+		grid.Clear();
+		grid.Insert(0, glm::vec2(5.0f, 250.0f), glm::vec2(5.0f, 250.0f) + PLAYER_SIZE);
+		grid.Insert(1, glm::vec2(870.0f, 250.0f), glm::vec2(870.0f, 250.0f) + PLAYER_SIZE);
+		for (unsigned int i = 0; i < count; ++i)
+			grid.Insert(i + 2, positions[i], positions[i] + 2.0f * BALL_RADIUS);
+		grid.Build();
+		grid.ForEachPair([&pairs](unsigned int, unsigned int) { ++pairs; });
+	}
+	benchmark::DoNotOptimize(pairs);
+	state.SetItemsProcessed(state.iterations() * count);
+}
+BENCHMARK(BM_Broadphase)->Arg(200)->Arg(1000)->Arg(4000);
+
+static void BM_ObstacleQuery(benchmark::State &state)
+{
+	// Arg: obstacles in a level (rows of 20x20 blocks from the top-left corner); one
+	// ball in the middle looks up the ones near it, so the cost depends on the blocks
+	// around the ball and not on how many the level has
+	GameLevel level;
+	level.BallRadius = BALL_RADIUS;
+	unsigned int count = static_cast<unsigned int>(state.range(0));
+	for (unsigned int i = 0; i < count; ++i)
+	{
+		Transform obstacle = { glm::vec2(i % 30 * 30.0f, i / 30 % 20 * 30.0f), glm::vec2(20.0f), 0.0f };
+		level.Obstacles.push_back(obstacle);
+	}
+	level.BuildGrid(SCREEN_WIDTH, SCREEN_HEIGHT);
+	Transform ball = { glm::vec2(437.0f, 287.0f), glm::vec2(BALL_RADIUS * 2.0f), 0.0f };
+	unsigned int hits = 0;
+	for (auto _ : state)
+	{
+		benchmark::DoNotOptimize(ball.Position);
+		level.ObstacleGrid.ForEachOverlap(ball.Position, ball.Position + ball.Size, [&](unsigned int obstacle) {
+			hits += std::get<0>(CheckCollision(ball, BALL_RADIUS, level.Obstacles[obstacle]));
+		});
+	}
+	benchmark::DoNotOptimize(hits);
+}
+BENCHMARK(BM_ObstacleQuery)->Arg(8)->Arg(600);
+
+static void BM_BatchStep(benchmark::State &state)
+{
+	// Args: difficulty (index of the built-in level), generic kernel; 4096 matches at 60 Hz
+	// advanced 60 ticks per iteration, so items are match-ticks
+	const float speeds[] = { 4.0f, 6.5f, 9.0f, 12.0f };
+	BatchRules rules = { speeds[state.range(0)], 60, static_cast<float>(SCREEN_WIDTH), static_cast<float>(SCREEN_HEIGHT),
+		BALL_RADIUS, PLAYER_WIDTH, PLAYER_HEIGHT };
+	BatchSimulator batch(4096, rules, state.range(1) != 0);
+	if (batch.Specialized() == (state.range(1) != 0))
+	{
+		state.SkipWithError("no kernel compiled for these rules");
+		return;
+	}
+	for (auto _ : state)
+	{
+		batch.Step(60);
+		benchmark::DoNotOptimize(batch.BallX.data());
+	}
+	state.SetItemsProcessed(state.iterations() * batch.Matches() * 60);
+}
+BENCHMARK(BM_BatchStep)->Args({0, 0})->Args({0, 1})->Args({3, 0})->Args({3, 1});
+
+// job system
+// ----------
+// stand-in for a unit of real work (a few hundred ns of arithmetic)
+static float busyWork(unsigned int seed)
+{
+	float x = static_cast<float>(seed);
+	for (int i = 0; i < 64; ++i)
+		x = x * 0.999f + 1.0f / (1.0f + x);
+	return x;
+}
+
+static void BM_JobSystemScaling(benchmark::State &state)
+{
+	// Arg: threads (including this one) sharing 64k items in chunks of 512
+	unsigned int threads = static_cast<unsigned int>(state.range(0));
+	if (threads > 1)
+		JobSystem::Start(threads - 1);
+	std::vector<float> results(65536);
+	for (auto _ : state)
+	{
+		JobSystem::ParallelFor(static_cast<unsigned int>(results.size()), 512, [&](unsigned int begin, unsigned int end) {
+			for (unsigned int i = begin; i < end; ++i)
+				results[i] = busyWork(i);
+		});
+		benchmark::DoNotOptimize(results.data());
+	}
+	state.SetItemsProcessed(state.iterations() * results.size());
+	JobSystem::Stop();
+}
+BENCHMARK(BM_JobSystemScaling)->Arg(1)->Arg(2)->Arg(4)->Arg(8)->UseRealTime();
+
+// a job that splits its range in half until it is small, as a tree of child jobs
+static void splitJob(void *context, unsigned int begin, unsigned int end)
+{
+	float *results = static_cast<float*>(context);
+	if (end - begin > 256)
+	{
+		unsigned int middle = begin + (end - begin) / 2;
+		JobSystem::RunChild(splitJob, context, begin, middle);
+		JobSystem::RunChild(splitJob, context, middle, end);
+		return;
+	}
+	for (unsigned int i = begin; i < end; ++i)
+		results[i] = busyWork(i);
+}
+
+static void BM_JobSystemChildren(benchmark::State &state)
+{
+	// Arg: threads; one root job over 64k items spawns ~256 descendants
+	unsigned int threads = static_cast<unsigned int>(state.range(0));
+	if (threads > 1)
+		JobSystem::Start(threads - 1);
+	std::vector<float> results(65536);
+	for (auto _ : state)
+	{
+		JobCounter counter;
+		JobSystem::Run(splitJob, results.data(), 0, static_cast<unsigned int>(results.size()), counter);
+		JobSystem::Wait(counter);
+		benchmark::DoNotOptimize(results.data());
+	}
+	state.SetItemsProcessed(state.iterations() * results.size());
+	JobSystem::Stop();
+}
+BENCHMARK(BM_JobSystemChildren)->Arg(1)->Arg(2)->Arg(4)->Arg(8)->UseRealTime();
+
+// rendering
+// ---------
+static void BM_DrawSprite(benchmark::State &state)
+{
+	// Arg: sprites per frame
+	if (!needsContext(state))
+		return;
+	SpriteRenderer renderer(ResourceManager::GetShader("sprite"));
+	Texture2D texture = ResourceManager::GetTexture("paddle1");
+	int count = static_cast<int>(state.range(0));
+	for (auto _ : state)
+	{
+		for (int i = 0; i < count; ++i)
+			renderer.DrawSprite(texture, glm::vec2(i % 30 * 30.0f, i / 30 * 20.0f), PLAYER_SIZE);
+		glFinish();
+	}
+	state.SetItemsProcessed(state.iterations() * count);
+}
+BENCHMARK(BM_DrawSprite)->Arg(1)->Arg(100);
+
+static void BM_ParticleDraw(benchmark::State &state)
+{
+	if (!needsContext(state))
+		return;
+	ParticleGenerator particles(ResourceManager::GetShader("particle"), ResourceManager::GetTexture("particle"), 500);
+	glm::vec2 ball(450.0f, 300.0f);
+	// spawn until the whole pool is alive
+	particles.Update(0.0f, ball, INITIAL_BALL_VELOCITY, 500);
+	for (auto _ : state)
+	{
+		FrameArena::Reset();
+		particles.Draw();
+		glFinish();
+	}
+	state.SetItemsProcessed(state.iterations() * 500);
+}
+BENCHMARK(BM_ParticleDraw);
+
+static void BM_RenderText(benchmark::State &state)
+{
+	if (!needsContext(state))
+		return;
+	TextRenderer text(SCREEN_WIDTH, SCREEN_HEIGHT);
+	text.Load("fonts/OCRAEXT.TTF", 20);
+	std::string line = "Press ENTER to start and ESC to quit";
+	for (auto _ : state)
+	{
+		FrameArena::Reset();
+		text.RenderText(line, 50.0f, 300.0f, 0.8f);
+		glFinish();
+	}
+	state.SetItemsProcessed(state.iterations() * line.size());
+}
+BENCHMARK(BM_RenderText);
+
+static void BM_GameRender(benchmark::State &state)
+{
+	// a complete frame of the running game
+	if (!needsContext(state))
+		return;
+	for (auto _ : state)
+	{
+		glClear(GL_COLOR_BUFFER_BIT);
+		PingPong->Render();
+		glFinish();
+	}
+}
+BENCHMARK(BM_GameRender);
+
+int main(int argc, char *argv[])
+{
+	// --data must come first so relative asset paths resolve
+	std::vector<char*> args;
+	for (int i = 0; i < argc; ++i)
+	{
+		if (strcmp(argv[i], "--data") == 0 && i + 1 < argc)
+		{
+			if (chdir(argv[++i]) != 0)
+			{
+				std::cout << "ERROR::BENCHMARK: Cannot change to data directory " << argv[i] << std::endl;
+				return -1;
+			}
+		}
+		else
+			args.push_back(argv[i]);
+	}
+	int count = static_cast<int>(args.size());
+	benchmark::Initialize(&count, &args[0]);
+	if (benchmark::ReportUnrecognizedArguments(count, &args[0]))
+		return -1;
+
+	// the context must outlive the game, whose destructor releases GL objects
+	OffscreenContext context;
+	Game game(SCREEN_WIDTH, SCREEN_HEIGHT);
+	game.AudioEnabled = false;
+	if (context.Create(SCREEN_WIDTH, SCREEN_HEIGHT))
+	{
+		glViewport(0, 0, SCREEN_WIDTH, SCREEN_HEIGHT);
+		glEnable(GL_BLEND);
+		glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+		game.Init();
+		// start a rally so the update and render benchmarks see a game in play
+		game.State = GAME_ACTIVE;
+		Context = &context;
+	}
+	PingPong = &game;
+	benchmark::RunSpecifiedBenchmarks();
+
+	ResourceManager::Clear();
+	return 0;
+}